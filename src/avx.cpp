@@ -1,61 +1,1061 @@
 #include "include/avx.hpp"
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <limits>
 #include <numeric>
 #include <optional>
 #include "include/constants.hpp"
+#include "include/ranks.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace avx {
 
 Logging::Logger& logger = Logging::Logger::get_instance();
 
-std::optional<float_t> vector_sum_avx2(
-    const std::vector<float_t>& values) noexcept {
-  float_t sum1 = 0.0f;
-  float_t sum2 = 0.0f;
-  float_t sum3 = 0.0f;
-  float_t sum4 = 0.0f;
-  float_t sum5 = 0.0f;
-  float_t sum6 = 0.0f;
-  float_t sum7 = 0.0f;
-  float_t sum8 = 0.0f;
+bool cpu_supports_avx2() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  static const bool supported = __builtin_cpu_supports("avx2") &&
+                                __builtin_cpu_supports("bmi") &&
+                                __builtin_cpu_supports("popcnt");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+/**
+ * Sums of the Pearson's correlation terms, gathered in a single pass.
+ * ACC values are shifted by a constant close to their mean (x' = x - shift),
+ * so that the sum of squares does not cancel out catastrophically
+ */
+struct Moments {
+  float_t x = 0.0f;   // Sum of x'
+  float_t xx = 0.0f;  // Sum of x'^2
+  float_t xy = 0.0f;  // Sum of x' * y
+  float_t y = 0.0f;   // Sum of y (~0, the HR values are already centered)
+};
+
+/**
+ * Number of series whose moments are gathered in one pass over the HR values.
+ * Their accumulators (3 per series) still fit into the vector registers
+ */
+constexpr size_t MAX_BATCH_SERIES = 4;
+
+/** Sum and dot product kernels of one instruction set */
+struct Kernels {
+  SIMD_LEVEL level;
+  float_t (*sum)(const float_t* values, const size_t count) noexcept;
+  float_t (*dot)(const float_t* first, const float_t* second,
+                 const size_t count) noexcept;
+  float_t (*neumaier_sum)(const float_t* values, const size_t count) noexcept;
+  float_t (*neumaier_dot)(const float_t* first, const float_t* second,
+                          const size_t count) noexcept;
+  // Fixed summation order, the same on every level that has it
+  float_t (*segment_sum)(const float_t* values, const size_t count) noexcept;
+  // Indexed by the number of series - 1
+  void (*moments[MAX_BATCH_SERIES])(const float_t* const* acc_values,
+                                    const float_t* shifts,
+                                    const float_t* hr_values_diffs,
+                                    const size_t count,
+                                    Moments* moments) noexcept;
+};
+
+static float_t sum_scalar(const float_t* values, const size_t count) noexcept {
+  float_t sums[8] = {};
+  const size_t body = count - count % 8;
+
+  // Independent accumulators, so that the additions may overlap
+  for (size_t i = 0; i < body; i += 8) {
+    for (size_t lane = 0; lane < 8; ++lane) {
+      sums[lane] += values[i + lane];
+    }
+  }
+
+  float_t sum = 0.0f;
+  for (size_t i = body; i < count; ++i) {
+    sum += values[i];
+  }
+
+  return sum + sums[0] + sums[1] + sums[2] + sums[3] + sums[4] + sums[5] +
+         sums[6] + sums[7];
+}
+
+static float_t dot_scalar(const float_t* first, const float_t* second,
+                          const size_t count) noexcept {
+  float_t sums[8] = {};
+  const size_t body = count - count % 8;
+
+  for (size_t i = 0; i < body; i += 8) {
+    for (size_t lane = 0; lane < 8; ++lane) {
+      sums[lane] += first[i + lane] * second[i + lane];
+    }
+  }
+
+  float_t sum = 0.0f;
+  for (size_t i = body; i < count; ++i) {
+    sum += first[i] * second[i];
+  }
+
+  return sum + sums[0] + sums[1] + sums[2] + sums[3] + sums[4] + sums[5] +
+         sums[6] + sums[7];
+}
+
+template <size_t SERIES>
+static void moments_scalar(const float_t* const* acc_values,
+                           const float_t* shifts,
+                           const float_t* hr_values_diffs, const size_t count,
+                           Moments* moments) noexcept {
+  // Four independent lanes per series, as in the vector kernels
+  Moments lanes[SERIES][4];
+  float_t y_lanes[4] = {};
+  const size_t body = count - count % 4;
+
+  for (size_t i = 0; i < body; i += 4) {
+    for (size_t lane = 0; lane < 4; ++lane) {
+      y_lanes[lane] += hr_values_diffs[i + lane];
+    }
+
+    for (size_t series = 0; series < SERIES; ++series) {
+      for (size_t lane = 0; lane < 4; ++lane) {
+        const float_t x = acc_values[series][i + lane] - shifts[series];
+        lanes[series][lane].x += x;
+        lanes[series][lane].xx += x * x;
+        lanes[series][lane].xy += x * hr_values_diffs[i + lane];
+      }
+    }
+  }
+
+  float_t y_sum = 0.0f;
+  for (size_t i = body; i < count; ++i) {
+    y_sum += hr_values_diffs[i];
+  }
+  y_sum += y_lanes[0] + y_lanes[1] + y_lanes[2] + y_lanes[3];
+
+  for (size_t series = 0; series < SERIES; ++series) {
+    moments[series] = Moments();
+    for (size_t i = body; i < count; ++i) {
+      const float_t x = acc_values[series][i] - shifts[series];
+      moments[series].x += x;
+      moments[series].xx += x * x;
+      moments[series].xy += x * hr_values_diffs[i];
+    }
+
+    for (const Moments& lane : lanes[series]) {
+      moments[series].x += lane.x;
+      moments[series].xx += lane.xx;
+      moments[series].xy += lane.xy;
+    }
+    moments[series].y = y_sum;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2"))) static inline float_t reduce_sse(
+    const __m128 values) noexcept {
+  __m128 sum = _mm_add_ps(values, _mm_movehl_ps(values, values));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+  return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("sse2"))) static float_t sum_sse(
+    const float_t* values, const size_t count) noexcept {
+  __m128 sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps();
+  const size_t body = count - count % 8;
+
+  for (size_t i = 0; i < body; i += 8) {
+    sum1 = _mm_add_ps(sum1, _mm_loadu_ps(values + i));
+    sum2 = _mm_add_ps(sum2, _mm_loadu_ps(values + i + 4));
+  }
 
+  float_t sum = reduce_sse(_mm_add_ps(sum1, sum2));
+  for (size_t i = body; i < count; ++i) {
+    sum += values[i];
+  }
+
+  return sum;
+}
+
+__attribute__((target("sse2"))) static float_t dot_sse(
+    const float_t* first, const float_t* second, const size_t count) noexcept {
+  __m128 sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps();
+  const size_t body = count - count % 8;
+
+  for (size_t i = 0; i < body; i += 8) {
+    sum1 = _mm_add_ps(
+        sum1, _mm_mul_ps(_mm_loadu_ps(first + i), _mm_loadu_ps(second + i)));
+    sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(first + i + 4),
+                                       _mm_loadu_ps(second + i + 4)));
+  }
+
+  float_t sum = reduce_sse(_mm_add_ps(sum1, sum2));
+  for (size_t i = body; i < count; ++i) {
+    sum += first[i] * second[i];
+  }
+
+  return sum;
+}
+
+template <size_t SERIES>
+__attribute__((target("sse2"))) static void moments_sse(
+    const float_t* const* acc_values, const float_t* shifts,
+    const float_t* hr_values_diffs, const size_t count,
+    Moments* moments) noexcept {
+  __m128 x_sums[SERIES], xx_sums[SERIES], xy_sums[SERIES], shift[SERIES];
+  for (size_t series = 0; series < SERIES; ++series) {
+    x_sums[series] = xx_sums[series] = xy_sums[series] = _mm_setzero_ps();
+    shift[series] = _mm_set1_ps(shifts[series]);
+  }
+
+  __m128 y_sums = _mm_setzero_ps();
+  const size_t body = count - count % 4;
+
+  // Every HR value is loaded once for all of the series
+  for (size_t i = 0; i < body; i += 4) {
+    const __m128 y = _mm_loadu_ps(hr_values_diffs + i);
+    y_sums = _mm_add_ps(y_sums, y);
+
+    for (size_t series = 0; series < SERIES; ++series) {
+      const __m128 x =
+          _mm_sub_ps(_mm_loadu_ps(acc_values[series] + i), shift[series]);
+      x_sums[series] = _mm_add_ps(x_sums[series], x);
+      xx_sums[series] = _mm_add_ps(xx_sums[series], _mm_mul_ps(x, x));
+      xy_sums[series] = _mm_add_ps(xy_sums[series], _mm_mul_ps(x, y));
+    }
+  }
+
+  for (size_t series = 0; series < SERIES; ++series) {
+    moments[series] = {reduce_sse(x_sums[series]), reduce_sse(xx_sums[series]),
+                       reduce_sse(xy_sums[series]), reduce_sse(y_sums)};
+
+    for (size_t i = body; i < count; ++i) {
+      const float_t x = acc_values[series][i] - shifts[series];
+      moments[series].x += x;
+      moments[series].xx += x * x;
+      moments[series].xy += x * hr_values_diffs[i];
+      moments[series].y += hr_values_diffs[i];
+    }
+  }
+}
+
+__attribute__((target("avx2"))) static inline float_t reduce_avx2(
+    const __m256 values) noexcept {
+  return reduce_sse(_mm_add_ps(_mm256_castps256_ps128(values),
+                               _mm256_extractf128_ps(values, 1)));
+}
+
+/** Lane masks of the tails, loaded from an offset of 8 - remaining */
+alignas(64) static const int32_t AVX2_TAIL_MASKS[16] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// The tails are handled by masked loads, which read nothing past the end
+__attribute__((target("avx2"))) static inline __m256i avx2_tail_mask(
+    const size_t remaining) noexcept {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+      AVX2_TAIL_MASKS + 8 - std::min<size_t>(remaining, 8)));
+}
+
+__attribute__((target("avx2"))) static float_t sum_avx2(
+    const float_t* values, const size_t count) noexcept {
+  __m256 sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps();
+  size_t i = 0;
+
+  for (; i + 16 <= count; i += 16) {
+    sum1 = _mm256_add_ps(sum1, _mm256_loadu_ps(values + i));
+    sum2 = _mm256_add_ps(sum2, _mm256_loadu_ps(values + i + 8));
+  }
+
+  for (; i < count; i += 8) {
+    sum1 = _mm256_add_ps(
+        sum1, _mm256_maskload_ps(values + i, avx2_tail_mask(count - i)));
+  }
+
+  return reduce_avx2(_mm256_add_ps(sum1, sum2));
+}
+
+__attribute__((target("avx2"))) static float_t dot_avx2(
+    const float_t* first, const float_t* second, const size_t count) noexcept {
+  __m256 sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps();
+  size_t i = 0;
+
+  for (; i + 16 <= count; i += 16) {
+    sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(first + i),
+                                             _mm256_loadu_ps(second + i)));
+    sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(_mm256_loadu_ps(first + i + 8),
+                                             _mm256_loadu_ps(second + i + 8)));
+  }
+
+  for (; i < count; i += 8) {
+    const __m256i mask = avx2_tail_mask(count - i);
+    sum1 = _mm256_add_ps(
+        sum1, _mm256_mul_ps(_mm256_maskload_ps(first + i, mask),
+                            _mm256_maskload_ps(second + i, mask)));
+  }
+
+  return reduce_avx2(_mm256_add_ps(sum1, sum2));
+}
+
+template <size_t SERIES>
+__attribute__((target("avx2"))) static void moments_avx2(
+    const float_t* const* acc_values, const float_t* shifts,
+    const float_t* hr_values_diffs, const size_t count,
+    Moments* moments) noexcept {
+  __m256 x_sums[SERIES], xx_sums[SERIES], xy_sums[SERIES], shift[SERIES];
+  for (size_t series = 0; series < SERIES; ++series) {
+    x_sums[series] = xx_sums[series] = xy_sums[series] = _mm256_setzero_ps();
+    shift[series] = _mm256_set1_ps(shifts[series]);
+  }
+
+  __m256 y_sums = _mm256_setzero_ps();
+
+  // Every HR value is loaded once for all of the series
+  for (size_t i = 0; i < count; i += 8) {
+    const __m256i mask = avx2_tail_mask(count - i);
+    const __m256 y = _mm256_maskload_ps(hr_values_diffs + i, mask);
+    y_sums = _mm256_add_ps(y_sums, y);
+
+    for (size_t series = 0; series < SERIES; ++series) {
+      // Masked out lanes stay zero instead of becoming -shift
+      const __m256 x = _mm256_and_ps(
+          _mm256_sub_ps(_mm256_maskload_ps(acc_values[series] + i, mask),
+                        shift[series]),
+          _mm256_castsi256_ps(mask));
+      x_sums[series] = _mm256_add_ps(x_sums[series], x);
+      xx_sums[series] = _mm256_add_ps(xx_sums[series], _mm256_mul_ps(x, x));
+      xy_sums[series] = _mm256_add_ps(xy_sums[series], _mm256_mul_ps(x, y));
+    }
+  }
+
+  for (size_t series = 0; series < SERIES; ++series) {
+    moments[series] = {reduce_avx2(x_sums[series]),
+                       reduce_avx2(xx_sums[series]),
+                       reduce_avx2(xy_sums[series]), reduce_avx2(y_sums)};
+  }
+}
+
+__attribute__((target("avx512f"))) static inline __mmask16 tail_mask(
+    const size_t remaining) noexcept {
+  return remaining >= 16 ? (__mmask16)0xFFFF
+                         : (__mmask16)((1u << remaining) - 1);
+}
+
+// Folded into the AVX2 reduction. _mm512_reduce_add_ps, _mm512_castps512_ps256
+// and _mm512_extractf64x4_pd pass an undefined vector through, which GCC 12
+// reports with -Wuninitialized - the zero masked extract with a full mask
+// compiles into the same instruction without it
+__attribute__((target("avx512f"))) static inline float_t reduce_avx512(
+    const __m512 values) noexcept {
+  const __m512d halves = _mm512_castps_pd(values);
+  return reduce_avx2(
+      _mm256_add_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(
+                        (__mmask8)0xFF, halves, 0)),
+                    _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(
+                        (__mmask8)0xFF, halves, 1))));
+}
+
+__attribute__((target("avx512f"))) static float_t sum_avx512(
+    const float_t* values, const size_t count) noexcept {
+  __m512 sum1 = _mm512_setzero_ps(), sum2 = _mm512_setzero_ps();
+  size_t i = 0;
+
+  for (; i + 32 <= count; i += 32) {
+    sum1 = _mm512_add_ps(sum1, _mm512_loadu_ps(values + i));
+    sum2 = _mm512_add_ps(sum2, _mm512_loadu_ps(values + i + 16));
+  }
+
+  for (; i < count; i += 16) {
+    sum1 = _mm512_add_ps(
+        sum1, _mm512_maskz_loadu_ps(tail_mask(count - i), values + i));
+  }
+
+  return reduce_avx512(_mm512_add_ps(sum1, sum2));
+}
+
+__attribute__((target("avx512f"))) static float_t dot_avx512(
+    const float_t* first, const float_t* second, const size_t count) noexcept {
+  __m512 sum1 = _mm512_setzero_ps(), sum2 = _mm512_setzero_ps();
+  size_t i = 0;
+
+  for (; i + 32 <= count; i += 32) {
+    sum1 = _mm512_add_ps(sum1, _mm512_mul_ps(_mm512_loadu_ps(first + i),
+                                             _mm512_loadu_ps(second + i)));
+    sum2 = _mm512_add_ps(sum2, _mm512_mul_ps(_mm512_loadu_ps(first + i + 16),
+                                             _mm512_loadu_ps(second + i + 16)));
+  }
+
+  for (; i < count; i += 16) {
+    const __mmask16 mask = tail_mask(count - i);
+    sum1 = _mm512_add_ps(
+        sum1, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, first + i),
+                            _mm512_maskz_loadu_ps(mask, second + i)));
+  }
+
+  return reduce_avx512(_mm512_add_ps(sum1, sum2));
+}
+
+template <size_t SERIES>
+__attribute__((target("avx512f"))) static void moments_avx512(
+    const float_t* const* acc_values, const float_t* shifts,
+    const float_t* hr_values_diffs, const size_t count,
+    Moments* moments) noexcept {
+  __m512 x_sums[SERIES], xx_sums[SERIES], xy_sums[SERIES], shift[SERIES];
+  for (size_t series = 0; series < SERIES; ++series) {
+    x_sums[series] = xx_sums[series] = xy_sums[series] = _mm512_setzero_ps();
+    shift[series] = _mm512_set1_ps(shifts[series]);
+  }
+
+  __m512 y_sums = _mm512_setzero_ps();
+
+  // Every HR value is loaded once for all of the series
+  for (size_t i = 0; i < count; i += 16) {
+    const __mmask16 mask = tail_mask(count - i);
+    const __m512 y = _mm512_maskz_loadu_ps(mask, hr_values_diffs + i);
+    y_sums = _mm512_add_ps(y_sums, y);
+
+    for (size_t series = 0; series < SERIES; ++series) {
+      // Masked out lanes stay zero instead of becoming -shift
+      const __m512 x = _mm512_maskz_sub_ps(
+          mask, _mm512_maskz_loadu_ps(mask, acc_values[series] + i),
+          shift[series]);
+      x_sums[series] = _mm512_add_ps(x_sums[series], x);
+      xx_sums[series] = _mm512_add_ps(xx_sums[series], _mm512_mul_ps(x, x));
+      xy_sums[series] = _mm512_add_ps(xy_sums[series], _mm512_mul_ps(x, y));
+    }
+  }
+
+  for (size_t series = 0; series < SERIES; ++series) {
+    moments[series] = {reduce_avx512(x_sums[series]),
+                       reduce_avx512(xx_sums[series]),
+                       reduce_avx512(xy_sums[series]), reduce_avx512(y_sums)};
+  }
+}
+#endif
+
+/**
+ * Neumaier's compensated addition - the rounding error of every addition is
+ * accumulated separately and added back at the end
+ */
+static inline void neumaier_add(float_t& sum, float_t& compensation,
+                                const float_t value) noexcept {
+  const float_t total = sum + value;
+  compensation += std::fabs(sum) >= std::fabs(value) ? (sum - total) + value
+                                                     : (value - total) + sum;
+  sum = total;
+}
+
+/** Compensated sum of the lanes of the vector kernels */
+static float_t neumaier_reduce(const float_t* sums,
+                               const float_t* compensations,
+                               const size_t lanes) noexcept {
+  float_t sum = 0.0f, compensation = 0.0f;
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    neumaier_add(sum, compensation, sums[lane]);
+    compensation += compensations[lane];
+  }
+
+  return sum + compensation;
+}
+
+static float_t neumaier_sum_scalar(const float_t* values,
+                                   const size_t count) noexcept {
+  float_t sum = 0.0f, compensation = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    neumaier_add(sum, compensation, values[i]);
+  }
+
+  return sum + compensation;
+}
+
+static float_t neumaier_dot_scalar(const float_t* first, const float_t* second,
+                                   const size_t count) noexcept {
+  float_t sum = 0.0f, compensation = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    neumaier_add(sum, compensation, first[i] * second[i]);
+  }
+
+  return sum + compensation;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SSE2 has no blend, the errors are selected by masks
+__attribute__((target("sse2"))) static inline void neumaier_add_sse(
+    __m128& sum, __m128& compensation, const __m128 value) noexcept {
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  const __m128 total = _mm_add_ps(sum, value);
+  const __m128 bigger =
+      _mm_cmpge_ps(_mm_andnot_ps(sign, sum), _mm_andnot_ps(sign, value));
+  const __m128 error_sum = _mm_add_ps(_mm_sub_ps(sum, total), value);
+  const __m128 error_value = _mm_add_ps(_mm_sub_ps(value, total), sum);
+
+  compensation = _mm_add_ps(
+      compensation, _mm_or_ps(_mm_and_ps(bigger, error_sum),
+                              _mm_andnot_ps(bigger, error_value)));
+  sum = total;
+}
+
+__attribute__((target("sse2"))) static float_t neumaier_sum_sse(
+    const float_t* values, const size_t count) noexcept {
+  __m128 sum = _mm_setzero_ps(), compensation = _mm_setzero_ps();
+  const size_t body = count - count % 4;
+
+  for (size_t i = 0; i < body; i += 4) {
+    neumaier_add_sse(sum, compensation, _mm_loadu_ps(values + i));
+  }
+
+  alignas(16) float_t sums[4], compensations[4];
+  _mm_store_ps(sums, sum);
+  _mm_store_ps(compensations, compensation);
+
+  return neumaier_reduce(sums, compensations, 4) +
+         neumaier_sum_scalar(values + body, count - body);
+}
+
+__attribute__((target("sse2"))) static float_t neumaier_dot_sse(
+    const float_t* first, const float_t* second, const size_t count) noexcept {
+  __m128 sum = _mm_setzero_ps(), compensation = _mm_setzero_ps();
+  const size_t body = count - count % 4;
+
+  for (size_t i = 0; i < body; i += 4) {
+    neumaier_add_sse(
+        sum, compensation,
+        _mm_mul_ps(_mm_loadu_ps(first + i), _mm_loadu_ps(second + i)));
+  }
+
+  alignas(16) float_t sums[4], compensations[4];
+  _mm_store_ps(sums, sum);
+  _mm_store_ps(compensations, compensation);
+
+  return neumaier_reduce(sums, compensations, 4) +
+         neumaier_dot_scalar(first + body, second + body, count - body);
+}
+
+__attribute__((target("avx2"))) static inline void neumaier_add_avx2(
+    __m256& sum, __m256& compensation, const __m256 value) noexcept {
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  const __m256 total = _mm256_add_ps(sum, value);
+  const __m256 bigger =
+      _mm256_cmp_ps(_mm256_andnot_ps(sign, sum), _mm256_andnot_ps(sign, value),
+                    _CMP_GE_OQ);
+  const __m256 error_sum = _mm256_add_ps(_mm256_sub_ps(sum, total), value);
+  const __m256 error_value = _mm256_add_ps(_mm256_sub_ps(value, total), sum);
+
+  compensation = _mm256_add_ps(
+      compensation, _mm256_blendv_ps(error_value, error_sum, bigger));
+  sum = total;
+}
+
+__attribute__((target("avx2"))) static float_t neumaier_sum_avx2(
+    const float_t* values, const size_t count) noexcept {
+  __m256 sum = _mm256_setzero_ps(), compensation = _mm256_setzero_ps();
+
+  // Masked out lanes add zero, which is exact
+  for (size_t i = 0; i < count; i += 8) {
+    neumaier_add_avx2(
+        sum, compensation,
+        _mm256_maskload_ps(values + i, avx2_tail_mask(count - i)));
+  }
+
+  alignas(32) float_t sums[8], compensations[8];
+  _mm256_store_ps(sums, sum);
+  _mm256_store_ps(compensations, compensation);
+
+  return neumaier_reduce(sums, compensations, 8);
+}
+
+__attribute__((target("avx2"))) static float_t neumaier_dot_avx2(
+    const float_t* first, const float_t* second, const size_t count) noexcept {
+  __m256 sum = _mm256_setzero_ps(), compensation = _mm256_setzero_ps();
+
+  for (size_t i = 0; i < count; i += 8) {
+    const __m256i mask = avx2_tail_mask(count - i);
+    neumaier_add_avx2(sum, compensation,
+                      _mm256_mul_ps(_mm256_maskload_ps(first + i, mask),
+                                    _mm256_maskload_ps(second + i, mask)));
+  }
+
+  alignas(32) float_t sums[8], compensations[8];
+  _mm256_store_ps(sums, sum);
+  _mm256_store_ps(compensations, compensation);
+
+  return neumaier_reduce(sums, compensations, 8);
+}
+
+__attribute__((target("avx512f"))) static inline void neumaier_add_avx512(
+    __m512& sum, __m512& compensation, const __m512 value) noexcept {
+  const __m512 total = _mm512_add_ps(sum, value);
+  const __mmask16 bigger =
+      _mm512_cmp_ps_mask(_mm512_abs_ps(sum), _mm512_abs_ps(value), _CMP_GE_OQ);
+  const __m512 error_sum = _mm512_add_ps(_mm512_sub_ps(sum, total), value);
+  const __m512 error_value = _mm512_add_ps(_mm512_sub_ps(value, total), sum);
+
+  compensation = _mm512_add_ps(
+      compensation, _mm512_mask_blend_ps(bigger, error_value, error_sum));
+  sum = total;
+}
+
+__attribute__((target("avx512f"))) static float_t neumaier_sum_avx512(
+    const float_t* values, const size_t count) noexcept {
+  __m512 sum = _mm512_setzero_ps(), compensation = _mm512_setzero_ps();
+
+  for (size_t i = 0; i < count; i += 16) {
+    neumaier_add_avx512(
+        sum, compensation,
+        _mm512_maskz_loadu_ps(tail_mask(count - i), values + i));
+  }
+
+  alignas(64) float_t sums[16], compensations[16];
+  _mm512_store_ps(sums, sum);
+  _mm512_store_ps(compensations, compensation);
+
+  return neumaier_reduce(sums, compensations, 16);
+}
+
+__attribute__((target("avx512f"))) static float_t neumaier_dot_avx512(
+    const float_t* first, const float_t* second, const size_t count) noexcept {
+  __m512 sum = _mm512_setzero_ps(), compensation = _mm512_setzero_ps();
+
+  for (size_t i = 0; i < count; i += 16) {
+    const __mmask16 mask = tail_mask(count - i);
+    neumaier_add_avx512(sum, compensation,
+                        _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, first + i),
+                                      _mm512_maskz_loadu_ps(mask, second + i)));
+  }
+
+  alignas(64) float_t sums[16], compensations[16];
+  _mm512_store_ps(sums, sum);
+  _mm512_store_ps(compensations, compensation);
+
+  return neumaier_reduce(sums, compensations, 16);
+}
+#endif
+
+/** Number of floats in an AVX2 register */
+constexpr size_t SUM_LANES = 8;
+
+/** Lane order of the horizontal reduction: ((0+4)+(2+6))+((1+5)+(3+7)) */
+static inline float_t reduce_lanes(const float_t lanes[SUM_LANES]) noexcept {
+  return ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) +
+         ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+}
+
+static float_t segment_sum_scalar(const float_t* values,
+                                  const size_t count) noexcept {
+  float_t lanes[SUM_LANES] = {};
+  const size_t body = count - count % SUM_LANES;
+
+  for (size_t i = 0; i < body; i += SUM_LANES) {
+    for (size_t lane = 0; lane < SUM_LANES; ++lane) {
+      lanes[lane] += values[i + lane];
+    }
+  }
+
+  float_t sum = reduce_lanes(lanes);
+  for (size_t i = body; i < count; ++i) {
+    sum += values[i];
+  }
+
+  return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static float_t segment_sum_avx2(
+    const float_t* values, const size_t count) noexcept {
+  __m256 lanes = _mm256_setzero_ps();
+  const size_t body = count - count % SUM_LANES;
+
+  for (size_t i = 0; i < body; i += SUM_LANES) {
+    lanes = _mm256_add_ps(lanes, _mm256_loadu_ps(values + i));
+  }
+
+  // Same pairing as reduce_lanes
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(lanes),
+                           _mm256_extractf128_ps(lanes, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 0x55));
+
+  float_t sum = _mm_cvtss_f32(half);
+  for (size_t i = body; i < count; ++i) {
+    sum += values[i];
+  }
+
+  return sum;
+}
+#endif
+
+static SIMD_LEVEL detect_simd_level() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  // Queries CPUID (and whether the OS saves the wider registers)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return SIMD_LEVEL::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return SIMD_LEVEL::AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SIMD_LEVEL::SSE;
+  }
+#endif
+  return SIMD_LEVEL::SCALAR;
+}
+
+/** Kernels of the widest supported instruction set, selected on first use */
+static const Kernels& kernels() noexcept {
+  static const Kernels selected = [] {
+    switch (detect_simd_level()) {
+#if defined(__x86_64__) || defined(__i386__)
+      case SIMD_LEVEL::AVX512:
+        return Kernels{SIMD_LEVEL::AVX512,
+                       sum_avx512,
+                       dot_avx512,
+                       neumaier_sum_avx512,
+                       neumaier_dot_avx512,
+                       segment_sum_avx2,
+                       {moments_avx512<1>, moments_avx512<2>,
+                        moments_avx512<3>, moments_avx512<4>}};
+      case SIMD_LEVEL::AVX2:
+        return Kernels{SIMD_LEVEL::AVX2,
+                       sum_avx2,
+                       dot_avx2,
+                       neumaier_sum_avx2,
+                       neumaier_dot_avx2,
+                       segment_sum_avx2,
+                       {moments_avx2<1>, moments_avx2<2>, moments_avx2<3>,
+                        moments_avx2<4>}};
+      case SIMD_LEVEL::SSE:
+        return Kernels{SIMD_LEVEL::SSE,
+                       sum_sse,
+                       dot_sse,
+                       neumaier_sum_sse,
+                       neumaier_dot_sse,
+                       segment_sum_scalar,
+                       {moments_sse<1>, moments_sse<2>, moments_sse<3>,
+                        moments_sse<4>}};
+#endif
+      default:
+        return Kernels{SIMD_LEVEL::SCALAR,
+                       sum_scalar,
+                       dot_scalar,
+                       neumaier_sum_scalar,
+                       neumaier_dot_scalar,
+                       segment_sum_scalar,
+                       {moments_scalar<1>, moments_scalar<2>,
+                        moments_scalar<3>, moments_scalar<4>}};
+    }
+  }();
+
+  return selected;
+}
+
+SIMD_LEVEL simd_level() noexcept { return kernels().level; }
+
+std::string simd_level_name(const SIMD_LEVEL level) noexcept {
+  switch (level) {
+    case SIMD_LEVEL::AVX512:
+      return "AVX-512";
+    case SIMD_LEVEL::AVX2:
+      return "AVX2";
+    case SIMD_LEVEL::SSE:
+      return "SSE";
+    default:
+      return "scalar";
+  }
+}
+
+/** Summation method used by vector_sum and dot_product */
+static std::atomic<SUMMATION> selected_summation{SUMMATION::PAIRWISE};
+
+/**
+ * Number of values summed by the plain kernels at the leaves of the pairwise
+ * summation. The error grows with log2(count / PAIRWISE_BLOCK_SIZE) only
+ */
+constexpr size_t PAIRWISE_BLOCK_SIZE = 1024;
+
+static float_t pairwise_sum(const float_t* values,
+                            const size_t count) noexcept {
+  if (count <= PAIRWISE_BLOCK_SIZE) {
+    return kernels().sum(values, count);
+  }
+
+  const size_t half = count / 2;
+  return pairwise_sum(values, half) + pairwise_sum(values + half, count - half);
+}
+
+static float_t pairwise_dot(const float_t* first, const float_t* second,
+                            const size_t count) noexcept {
+  if (count <= PAIRWISE_BLOCK_SIZE) {
+    return kernels().dot(first, second, count);
+  }
+
+  const size_t half = count / 2;
+  return pairwise_dot(first, second, half) +
+         pairwise_dot(first + half, second + half, count - half);
+}
+
+void set_summation(const SUMMATION summation) noexcept {
+  selected_summation = summation;
+}
+
+SUMMATION summation() noexcept { return selected_summation; }
+
+std::string summation_name(const SUMMATION summation) noexcept {
+  switch (summation) {
+    case SUMMATION::PAIRWISE:
+      return "pairwise";
+    case SUMMATION::NEUMAIER:
+      return "neumaier";
+    default:
+      return "naive";
+  }
+}
+
+std::optional<SUMMATION> parse_summation(const std::string& name) noexcept {
+  for (const SUMMATION summation :
+       {SUMMATION::NAIVE, SUMMATION::PAIRWISE, SUMMATION::NEUMAIER}) {
+    if (summation_name(summation) == name) {
+      return summation;
+    }
+  }
+
+  return std::nullopt;
+}
+
+float_t vector_sum(const DataPreprocessing::SeriesView values,
+                   const SUMMATION summation) noexcept {
+  switch (summation) {
+    case SUMMATION::PAIRWISE:
+      return pairwise_sum(values.data(), values.size());
+    case SUMMATION::NEUMAIER:
+      return kernels().neumaier_sum(values.data(), values.size());
+    default:
+      return kernels().sum(values.data(), values.size());
+  }
+}
+
+float_t vector_sum(const DataPreprocessing::SeriesView values) noexcept {
+  return vector_sum(values, selected_summation);
+}
+
+float_t dot_product(const DataPreprocessing::SeriesView first,
+                    const DataPreprocessing::SeriesView second) noexcept {
+  const size_t count = std::min(first.size(), second.size());
+  switch (selected_summation.load()) {
+    case SUMMATION::PAIRWISE:
+      return pairwise_dot(first.data(), second.data(), count);
+    case SUMMATION::NEUMAIER:
+      return kernels().neumaier_dot(first.data(), second.data(), count);
+    default:
+      return kernels().dot(first.data(), second.data(), count);
+  }
+}
+
+std::optional<float_t> vector_sum_avx2(
+    const DataPreprocessing::SeriesView values) noexcept {
   if (values.empty()) {
     logger.log_error(errors::ERRORS::PARAMETER_WAS_EMPTY);
     return std::nullopt;
   }
 
-  if (values.size() < MIN_VEC_SIZE_AVX2) {
-    logger.log_error(errors::ERRORS::INVALID_AVX_VECTOR_SIZE);
+  return vector_sum(values);
+}
+
+/**
+ * Number of consecutive windows updated incrementally. Every block of windows
+ * starts from sums computed from scratch (re-anchored), which bounds the
+ * accumulated rounding error and lets the blocks run in parallel
+ */
+constexpr size_t ROLLING_REANCHOR_WINDOWS = 256;
+
+/** Sums of a rolling window. Both series are shifted by the block's anchor */
+struct WindowSums {
+  double x = 0.0;   // Sum of x'
+  double xx = 0.0;  // Sum of x'^2
+  double y = 0.0;   // Sum of y'
+  double yy = 0.0;  // Sum of y'^2
+  double xy = 0.0;  // Sum of x' * y'
+
+  WindowSums& operator+=(const WindowSums& other) noexcept {
+    x += other.x;
+    xx += other.xx;
+    y += other.y;
+    yy += other.yy;
+    xy += other.xy;
+    return *this;
+  }
+
+  WindowSums& operator-=(const WindowSums& other) noexcept {
+    x -= other.x;
+    xx -= other.xx;
+    y -= other.y;
+    yy -= other.yy;
+    xy -= other.xy;
+    return *this;
+  }
+};
+
+/**
+ * Sums of a segment of both series, gathered by one pass of the moments kernel.
+ * The HR series is passed as the second series and as y at the same time
+ */
+static WindowSums segment_sums(const float_t* acc_values,
+                               const float_t* hr_values, const size_t count,
+                               const float_t acc_shift,
+                               const float_t hr_shift) noexcept {
+  const float_t* series[2] = {acc_values, hr_values};
+  const float_t shifts[2] = {acc_shift, hr_shift};
+  Moments moments[2];
+  kernels().moments[1](series, shifts, hr_values, count, moments);
+
+  WindowSums sums;
+  sums.x = moments[0].x;
+  sums.xx = moments[0].xx;
+  sums.y = moments[1].x;
+  sums.yy = moments[1].xx;
+  // Sum of x' * (y - hr_shift)
+  sums.xy = (double)moments[0].xy - (double)hr_shift * moments[0].x;
+  return sums;
+}
+
+std::optional<std::vector<float_t>> calculate_rolling_correlations(
+    const DataPreprocessing::SeriesView acc_values,
+    const DataPreprocessing::SeriesView hr_values, const size_t window,
+    const size_t step) noexcept {
+  if (acc_values.size() != hr_values.size() || window < 2 || step == 0 ||
+      window > acc_values.size()) {
+    logger.log_error(errors::ERRORS::INVALID_ARGUMENT,
+                     "(rolling correlation of " +
+                         std::to_string(acc_values.size()) + " and " +
+                         std::to_string(hr_values.size()) +
+                         " values with window " + std::to_string(window) +
+                         " and step " + std::to_string(step) + ")");
     return std::nullopt;
   }
 
-  size_t diff = values.size() % FLOATS_PER_AVX2;
-  if (diff > 0) {
-    logger.log_error(errors::ERRORS::INVALID_AVX_VECTOR_SIZE,
-                     "(Padding difference: " + std::to_string(diff) + ")");
+  const size_t windows_count = (acc_values.size() - window) / step + 1;
+  std::vector<float_t> correlations(windows_count);
+
+  std::vector<size_t> blocks((windows_count + ROLLING_REANCHOR_WINDOWS - 1) /
+                             ROLLING_REANCHOR_WINDOWS);
+  std::iota(blocks.begin(), blocks.end(), 0);
+
+  std::for_each(
+      std::execution::par, blocks.begin(), blocks.end(),
+      [&](const size_t block) {
+        const size_t first = block * ROLLING_REANCHOR_WINDOWS;
+        const size_t last =
+            std::min(first + ROLLING_REANCHOR_WINDOWS, windows_count);
+
+        const float_t acc_shift = acc_values[first * step];
+        const float_t hr_shift = hr_values[first * step];
+        const auto sums_of = [&](const size_t begin, const size_t end) {
+          return segment_sums(acc_values.data() + begin,
+                              hr_values.data() + begin, end - begin,
+                              acc_shift, hr_shift);
+        };
+
+        WindowSums sums = sums_of(first * step, first * step + window);
+        for (size_t i = first; i < last; ++i) {
+          const size_t begin = i * step;
+
+          if (i > first && step < window) {
+            // Slide - add the values entering the window, remove the leaving
+            sums += sums_of(begin - step + window, begin + window);
+            sums -= sums_of(begin - step, begin);
+          } else if (i > first) {
+            sums = sums_of(begin, begin + window);  // Windows do not overlap
+          }
+
+          const double covariance = sums.xy - sums.x * sums.y / window;
+          const double acc_variance = sums.xx - sums.x * sums.x / window;
+          const double hr_variance = sums.yy - sums.y * sums.y / window;
+
+          // Undefined for a constant window
+          correlations[i] = acc_variance > 0.0 && hr_variance > 0.0
+                                ? (float_t)(covariance /
+                                            std::sqrt(acc_variance *
+                                                      hr_variance))
+                                : std::numeric_limits<float_t>::quiet_NaN();
+        }
+      });
+
+  return correlations;
+}
+
+float_t segment_sum(const float_t* values, const size_t count) noexcept {
+  return kernels().segment_sum(values, count);
+}
+
+/** Pearson's correlation coefficient from the moments of one series */
+static float_t correlation_of(const Moments& moments, const size_t count,
+                              const float_t hr_diff_square_root) noexcept {
+  // Sums of (x - avg_x) * y and of (x - avg_x)^2 from the shifted sums
+  const float_t nominator = moments.xy - moments.x * moments.y / count;
+  const float_t acc_diff_squared =
+      std::max(moments.xx - moments.x * moments.x / count, 0.0f);
+
+  return nominator / (sqrtf(acc_diff_squared) * hr_diff_square_root);
+}
+
+std::optional<std::vector<float_t>> calculate_pearsons_correlations(
+    const std::vector<DataPreprocessing::SeriesView>& acc_values,
+    const DataPreprocessing::SeriesView hr_values_diffs,
+    const float_t hr_diff_square_root) noexcept {
+  if (acc_values.empty() || hr_values_diffs.empty()) {
+    logger.log_error(
+        errors::ERRORS::PARAMETER_WAS_EMPTY,
+        "(input vector of values for the Pearson's correlation calculation)");
     return std::nullopt;
   }
 
-  // Loop unwrapping just to make sure we make the best effort for vectorization
-  for (size_t i = 0; i < values.size(); i += FLOATS_PER_AVX2) {
-    sum1 += values[i];
-    sum2 += values[i + 1];
-    sum3 += values[i + 2];
-    sum4 += values[i + 3];
-    sum5 += values[i + 4];
-    sum6 += values[i + 5];
-    sum7 += values[i + 6];
-    sum8 += values[i + 7];
+  const size_t count = hr_values_diffs.size();
+  for (size_t series = 0; series < acc_values.size(); ++series) {
+    if (acc_values[series].size() != count) {
+      logger.log_error(
+          errors::ERRORS::INVALID_ARGUMENT,
+          "(vectors for Pearson's correlation are not the same size (series " +
+              std::to_string(series) + ", diff = " +
+              std::to_string((int64_t)acc_values[series].size() -
+                             (int64_t)count) +
+              ")");
+      return std::nullopt;
+    }
   }
 
-  return sum1 + sum2 + sum3 + sum4 + sum5 + sum6 + sum7 + sum8;
+  std::vector<float_t> correlations(acc_values.size());
+
+  // Series are processed in batches, each batch streams the HR values once
+  for (size_t first = 0; first < acc_values.size();
+       first += MAX_BATCH_SERIES) {
+    const size_t batch =
+        std::min(MAX_BATCH_SERIES, acc_values.size() - first);
+
+    const float_t* series_data[MAX_BATCH_SERIES];
+    float_t shifts[MAX_BATCH_SERIES];
+    Moments moments[MAX_BATCH_SERIES];
+    for (size_t series = 0; series < batch; ++series) {
+      series_data[series] = acc_values[first + series].data();
+      shifts[series] = acc_values[first + series][0];
+    }
+
+    kernels().moments[batch - 1](series_data, shifts, hr_values_diffs.data(),
+                                 count, moments);
+
+    for (size_t series = 0; series < batch; ++series) {
+      correlations[first + series] =
+          correlation_of(moments[series], count, hr_diff_square_root);
+    }
+  }
+
+  return correlations;
 }
 
 std::optional<float_t> calculate_pearsons_correlation(
-    const std::vector<float_t>& acc_values,
-    const std::vector<float_t>& hr_values_diffs,
+    const DataPreprocessing::SeriesView acc_values,
+    const DataPreprocessing::SeriesView hr_values_diffs,
     const float_t hr_diff_square_root) noexcept {
-  float_t correlation = 0;
-
   if (acc_values.empty() || hr_values_diffs.empty()) {
     logger.log_error(
         errors::ERRORS::PARAMETER_WAS_EMPTY,
@@ -63,51 +1063,56 @@ std::optional<float_t> calculate_pearsons_correlation(
     return std::nullopt;
   }
 
-  int32_t diff = acc_values.size() - hr_values_diffs.size();
-  if (diff != 0) {
+  const size_t count = hr_values_diffs.size();
+  if (acc_values.size() != count) {
     logger.log_error(
         errors::ERRORS::INVALID_ARGUMENT,
         "(vectors for Pearson's correlation are not the same size (diff = " +
-            std::to_string(diff) + ")");
+            std::to_string((int64_t)acc_values.size() - (int64_t)count) +
+            ")");
     return std::nullopt;
   }
 
-  // First pass - get averages
-  std::optional<float_t> tmp_sum = vector_sum_avx2(acc_values);
-  if (tmp_sum == std::nullopt) {
-    return std::nullopt;
-  }
+  // Single series kernel directly, no batch bookkeeping on the heap
+  const float_t* series_data[1] = {acc_values.data()};
+  const float_t shifts[1] = {acc_values[0]};
+  Moments moments[1];
+  kernels().moments[0](series_data, shifts, hr_values_diffs.data(), count,
+                       moments);
 
-  /* logger.log_debug("ACC VALUES VEC SUM (AVX): " + */
-  /*                  std::to_string(tmp_sum.value())); */
-
-  float_t avg_acc = tmp_sum.value() / acc_values.size();
-  /* logger.log_debug("ACC VALUES AVG (AVX): " + std::to_string(avg_acc)); */
-
-  std::vector<float_t> acc_diff_squared(acc_values.size());
-  std::vector<float_t> nominator(acc_values.size());
-  for (size_t i = 0; i < acc_values.size(); ++i) {
-    nominator[i] = (acc_values[i] - avg_acc) * (hr_values_diffs[i]);
-    acc_diff_squared[i] = (acc_values[i] - avg_acc) * (acc_values[i] - avg_acc);
-  }
+  return correlation_of(moments[0], count, hr_diff_square_root);
+}
 
-  std::optional tmp = vector_sum_avx2(nominator);
-  if (tmp == std::nullopt) {
+std::optional<std::vector<float_t>> calculate_spearmans_correlations(
+    const std::vector<DataPreprocessing::SeriesView>& acc_values,
+    const DataPreprocessing::SeriesView hr_values) noexcept {
+  if (acc_values.empty() || hr_values.empty()) {
+    logger.log_error(
+        errors::ERRORS::PARAMETER_WAS_EMPTY,
+        "(input vector of values for the Spearman's correlation calculation)");
     return std::nullopt;
   }
 
-  correlation = tmp.value();
-  /* logger.log_debug("Nominator (AVX): " + std::to_string(correlation)); */
-  tmp = vector_sum_avx2(acc_diff_squared);
-  if (tmp == std::nullopt) {
-    return std::nullopt;
+  // Average of the ranks is (n + 1) / 2 regardless of the ties
+  DataPreprocessing::SubjectSeries hr_ranks_diffs =
+      DataPreprocessing::rank_values(hr_values);
+  const float_t rank_avg = (float_t)(hr_values.size() + 1) / 2.0f;
+  for (float_t& rank : hr_ranks_diffs) {
+    rank -= rank_avg;
   }
+  const float_t hr_diff_square_root =
+      sqrtf(dot_product(hr_ranks_diffs, hr_ranks_diffs));
 
-  /* logger.log_debug("ACC DIFF SQUARED SUM (AVX): " + */
-  /*                  std::to_string(tmp.value())); */
-  correlation /= sqrtf(tmp.value()) * hr_diff_square_root;
+  std::vector<DataPreprocessing::SubjectSeries> acc_ranks;
+  acc_ranks.reserve(acc_values.size());
+  for (const DataPreprocessing::SeriesView values : acc_values) {
+    acc_ranks.push_back(DataPreprocessing::rank_values(values));
+  }
 
-  return correlation;
+  return calculate_pearsons_correlations(
+      std::vector<DataPreprocessing::SeriesView>(acc_ranks.begin(),
+                                                 acc_ranks.end()),
+      hr_ranks_diffs, hr_diff_square_root);
 }
 
 }  // namespace avx
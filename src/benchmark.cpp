@@ -0,0 +1,144 @@
+#include "include/benchmark.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <random>
+#include <thread>
+#include "include/avx.hpp"
+#include "include/constants.hpp"
+#include "include/data_preprocessing.hpp"
+#include "include/logger.hpp"
+
+namespace benchmark {
+
+Logging::Logger& logger = Logging::Logger::get_instance();
+
+/** Number of measurements per reader, the best one is reported */
+constexpr size_t BENCHMARK_REPEATS = 3;
+
+/** Number of values summed by the summation benchmark (a day and a half of ACC values) */
+constexpr size_t SUMMATION_BENCHMARK_VALUES = 1 << 22;
+
+void run_parse_benchmark(const std::string& acc_file_path,
+                         const std::string& hr_file_path) noexcept {
+  const std::vector<std::pair<std::string, DataPreprocessing::INPUT_READER>>
+      readers = {
+          {"stream (getline + stoi)", DataPreprocessing::INPUT_READER::STREAM},
+          {"mmap (scalar)", DataPreprocessing::INPUT_READER::MMAP_SCALAR},
+          {std::string("mmap (") +
+               (avx::cpu_supports_avx2() ? "AVX2" : "AVX2 not supported") +
+               ")",
+           DataPreprocessing::INPUT_READER::MMAP},
+      };
+
+  const double file_size =
+      (double)std::filesystem::file_size(acc_file_path) / 1e9;  // In GB
+
+  logger.log_info("Benchmarking ACC parsing of " + acc_file_path + " (" +
+                  std::to_string(file_size) + " GB)");
+
+  for (const auto& [name, reader] : readers) {
+    double best_time = std::numeric_limits<double>::max();
+    size_t lines = 0;
+
+    for (size_t i = 0; i < BENCHMARK_REPEATS; ++i) {
+      DataPreprocessing::SubjectDataProcessor processor(
+          acc_file_path, hr_file_path, reader, 1, false);
+
+      // Progress messages would be measured as well
+      const enum Logging::LOG_LEVEL log_level = Logging::APP_LOGGING_LEVEL;
+      Logging::APP_LOGGING_LEVEL = Logging::LOG_LEVEL::WARNING;
+
+      const auto start = std::chrono::steady_clock::now();
+      const auto parsed = processor.parse_acc_file();
+      const auto stop = std::chrono::steady_clock::now();
+
+      Logging::APP_LOGGING_LEVEL = log_level;
+
+      if (parsed == std::nullopt) {
+        logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE,
+                         "(Benchmark of the " + name + " reader)");
+        return;
+      }
+
+      lines = parsed.value()[0].size();
+      best_time = std::min(
+          best_time, std::chrono::duration<double>(stop - start).count());
+    }
+
+    logger.log_info("ACC reader " + name + ": " +
+                    std::to_string(file_size / best_time) + " GB/s (" +
+                    std::to_string(lines) + " lines in " +
+                    std::to_string(best_time) + " s)");
+  }
+
+  // Decoding the per-row timestamps on top of the values
+  double best_time = std::numeric_limits<double>::max();
+  size_t timestamps = 0;
+  for (size_t i = 0; i < BENCHMARK_REPEATS; ++i) {
+    DataPreprocessing::SubjectDataProcessor processor(
+        acc_file_path, hr_file_path, DataPreprocessing::INPUT_READER::MMAP, 1,
+        false);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto decoded = processor.parse_acc_timestamps();
+    const auto stop = std::chrono::steady_clock::now();
+
+    if (decoded == std::nullopt) {
+      logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE,
+                       "(Benchmark of the timestamp decoder)");
+      return;
+    }
+
+    timestamps = decoded.value().size();
+    best_time = std::min(best_time,
+                         std::chrono::duration<double>(stop - start).count());
+  }
+
+  logger.log_info("ACC timestamp decoder: " +
+                  std::to_string(file_size / best_time) + " GB/s (" +
+                  std::to_string(timestamps) + " timestamps in " +
+                  std::to_string(best_time) + " s)");
+}
+
+void run_summation_benchmark() noexcept {
+  std::mt19937 generator(42);  // Fixed seed, so that the runs are comparable
+  std::uniform_real_distribution<float_t> distribution(0.0f, 1.0f);
+
+  DataPreprocessing::SubjectSeries values(SUMMATION_BENCHMARK_VALUES);
+  long double reference = 0.0L;
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = distribution(generator);
+    reference += values[i];
+  }
+
+  const double size = (double)(values.size() * sizeof(float_t)) / 1e9;
+  logger.log_info("Benchmarking summation of " +
+                  std::to_string(values.size()) + " values (" +
+                  avx::simd_level_name(avx::simd_level()) + " kernels)");
+
+  for (const avx::SUMMATION summation :
+       {avx::SUMMATION::NAIVE, avx::SUMMATION::PAIRWISE,
+        avx::SUMMATION::NEUMAIER}) {
+    double best_time = std::numeric_limits<double>::max();
+    float_t sum = 0.0f;
+
+    for (size_t i = 0; i < BENCHMARK_REPEATS; ++i) {
+      const auto start = std::chrono::steady_clock::now();
+      sum = avx::vector_sum(values, summation);
+      const auto stop = std::chrono::steady_clock::now();
+
+      best_time = std::min(
+          best_time, std::chrono::duration<double>(stop - start).count());
+    }
+
+    const long double relative_error =
+        std::fabs((long double)sum - reference) / reference;
+    logger.log_info("Summation " + avx::summation_name(summation) + ": " +
+                    std::to_string(size / best_time) +
+                    " GB/s, relative error " +
+                    std::to_string((double)relative_error));
+  }
+}
+}  // namespace benchmark
@@ -8,19 +8,23 @@ const std::string FILE_PATH_SEPARATOR =
 #endif
     ;
 
-const uint8_t MAX_SUPPORTED_PERIOD_SIZE = 1;
+const uint8_t MAX_SUPPORTED_PERIOD_SIZE = 60;
 
 const std::string RESOURCE_FOLDER_PATH = "resources";
 const std::string SOURCE_FILE_FORMAT = ".csv";
+const std::string CACHE_FILE_FORMAT = ".bin";
+const std::string GZIP_FILE_FORMAT = ".gz";
+const std::string ZSTD_FILE_FORMAT = ".zst";
 const std::string OPENCL_KERNEL_FILE_PATH = "src/kernel.cl";
+const std::string OPENCL_BUILD_OPTIONS = "-cl-std=CL2.0";
+const std::string OPENCL_PROGRAM_CACHE_FOLDER_PATH = "cache";
 const uint8_t RETURN_OK = 0;
 const uint8_t RETURN_NOK = -1;
 const uint8_t ACC_SAMPLE_FREQ = 32;
 const uint8_t HR_SAMPLE_FREQ = 1;
 const uint8_t HR_MAX_VALUE = 255;
 const uint8_t ACC_NO_VALUES = 3;
-const uint8_t FLOATS_PER_AVX2 = 8;
-const uint8_t MIN_VEC_SIZE_AVX2 = 16;
+const size_t MAX_PARSE_THREADS = 16;
 
 const float_t X_FLOAT_REPRESENTATION = 11.0f;
 const float_t ADD_FLOAT_REPRESENTATION = 1.0f;
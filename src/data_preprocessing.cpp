@@ -1,23 +1,41 @@
 #include "include/data_preprocessing.hpp"
 #include <algorithm>
 #include <array>
+#include <charconv>
 #include <climits>
 #include <cstdint>
+#include <cstring>
 #include <execution>
+#include <functional>
 #include <iostream>
+#include <numeric>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <thread>
+#include "include/avx.hpp"
 #include "include/constants.hpp"
+#include "include/decompressor.hpp"
 #include "include/errors.hpp"
 #include "include/logger.hpp"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 namespace DataPreprocessing {
 
 Logging::Logger& logger = Logging::Logger::get_instance();
 
 SubjectDataProcessor::SubjectDataProcessor(const std::string& _acc_file_path,
-                                           const std::string& _hr_file_path) {
+                                           const std::string& _hr_file_path,
+                                           const INPUT_READER reader,
+                                           const size_t parse_threads,
+                                           const bool use_cache)
+    : _reader(reader),
+      _parse_threads(std::max<size_t>(1, parse_threads)),
+      _use_acc_cache(use_cache),
+      _use_hr_cache(use_cache) {
   if (_acc_file_path.empty() || _hr_file_path.empty()) {
     throw std::invalid_argument("File path argument must not be empty");
   }
@@ -31,6 +49,34 @@ SubjectDataProcessor::SubjectDataProcessor(const std::string& _acc_file_path,
 
   this->_acc_file_path = _acc_file_path;
   this->_hr_file_path = _hr_file_path;
+  this->_acc_compression =
+      StreamingDecompressor::compression_of(_acc_file_path);
+  this->_hr_compression = StreamingDecompressor::compression_of(_hr_file_path);
+
+  // Compressed files are always decompressed into memory, never mapped
+  if (this->_reader != INPUT_READER::STREAM) {
+    if (this->_acc_compression == COMPRESSION::NONE) {
+      this->_acc_file_map = MappedFile(_acc_file_path);
+    }
+
+    if (this->_hr_compression == COMPRESSION::NONE) {
+      this->_hr_file_map = MappedFile(_hr_file_path);
+    }
+
+    if ((this->_acc_compression == COMPRESSION::NONE &&
+         !this->_acc_file_map.is_mapped()) ||
+        (this->_hr_compression == COMPRESSION::NONE &&
+         !this->_hr_file_map.is_mapped())) {
+      logger.log_warning(warnings::WARNINGS::FILE_NOT_MAPPED,
+                         "(" + _acc_file_path + " or " + _hr_file_path + ")");
+      this->_reader = INPUT_READER::STREAM;
+    }
+  }
+
+  if (use_cache) {
+    this->_acc_cache = SubjectCache(_acc_file_path, ACC_NO_VALUES);
+    this->_hr_cache = SubjectCache(_hr_file_path, 1);
+  }
 }
 
 SubjectDataProcessor::~SubjectDataProcessor() {
@@ -45,6 +91,163 @@ SubjectDataProcessor::~SubjectDataProcessor() {
 
 // PRIVATE METHODS //
 
+std::optional<int64_t> SubjectDataProcessor::read_start_epoch(
+    std::ifstream& file_stream, const std::string& file_path,
+    const std::string& structure) noexcept {
+  std::string curr_line;
+
+  if (StreamingDecompressor::compression_of(file_path) != COMPRESSION::NONE) {
+    size_t line = 0;
+
+    // Only the first block gets decompressed
+    StreamingDecompressor decompressor(file_path);
+    const bool decompressed = decompressor.read_lines(
+        [&curr_line, &line](const char* cursor, const char* const end) {
+          for (; line < 2 && cursor < end; ++line) {
+            const char* next_line = skip_lines(cursor, end, 1);
+            if (line == 1) {  // Skip the first line
+              curr_line.assign(cursor, next_line);
+            }
+            cursor = next_line;
+          }
+
+          return line < 2;
+        });
+
+    if (!decompressed) {
+      logger.log_error(errors::ERRORS::COULD_NOT_DECOMPRESS_FILE,
+                       decompressor.error());
+      return std::nullopt;
+    }
+  } else {
+    file_stream.clear();
+    file_stream.seekg(file_stream.beg);
+
+    std::getline(file_stream, curr_line);  // Skip the first line
+    std::getline(file_stream, curr_line);
+  }
+
+  const u_long pos = curr_line.find(DATA_DELIMITER);
+  if (pos == std::string::npos) {
+    logger.log_error(errors::ERRORS::INVALID_FILE_STRUCTURE, structure);
+    return std::nullopt;
+  }
+
+  curr_line.erase(pos + 1, curr_line.length() - 1);
+
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             parse_datetime(curr_line, DATETIME_FORMAT).time_since_epoch())
+      .count();
+}
+
+void SubjectDataProcessor::build_acc_cache() noexcept {
+  // Attempted only once - after a failure the file is parsed directly
+  _use_acc_cache = false;
+
+  const std::optional<int64_t> start_epoch = read_start_epoch(
+      _acc_file_stream, _acc_file_path,
+      "ACC files must have the following structure: datetime,acc_x,acc_y,acc_z");
+  if (start_epoch == std::nullopt) {
+    return;
+  }
+
+  // The cache contains the whole file, the timestamp sync is applied when loading
+  bool written = false;
+  if (_acc_compression == COMPRESSION::NONE &&
+      _reader != INPUT_READER::STREAM) {
+    // Encoded while parsing, one byte per value instead of a float
+    const std::optional<std::vector<char>> encoded = encode_acc_buffer();
+    written = encoded != std::nullopt &&
+              SubjectCache::write_encoded(_acc_file_path, start_epoch.value(),
+                                          ACC_SAMPLE_FREQ, ACC_NO_VALUES,
+                                          encoded.value(), true);
+  } else {
+    const std::optional parsed = _acc_compression != COMPRESSION::NONE
+                                     ? parse_acc_compressed()
+                                     : parse_acc_stream();
+    if (parsed == std::nullopt) {
+      return;
+    }
+
+    const std::array<std::vector<float_t>, ACC_NO_VALUES>& values =
+        parsed.value();
+    written = SubjectCache::write(_acc_file_path, start_epoch.value(),
+                                  ACC_SAMPLE_FREQ,
+                                  {&values[0], &values[1], &values[2]}, true);
+  }
+
+  if (written) {
+    _acc_cache = SubjectCache(_acc_file_path, ACC_NO_VALUES);
+  } else {
+    logger.log_warning(warnings::WARNINGS::CACHE_NOT_WRITTEN,
+                       "(" + _acc_file_path + ")");
+  }
+}
+
+void SubjectDataProcessor::build_hr_cache() noexcept {
+  // Attempted only once - after a failure the file is parsed directly
+  _use_hr_cache = false;
+
+  const std::optional<int64_t> start_epoch =
+      read_start_epoch(_hr_file_stream, _hr_file_path,
+                       "HR files must have the following structure: "
+                       "datetime,hr");
+  if (start_epoch == std::nullopt) {
+    return;
+  }
+
+  const std::optional parsed =
+      _hr_compression != COMPRESSION::NONE ? parse_hr_compressed()
+      : _reader != INPUT_READER::STREAM    ? parse_hr_buffer()
+                                           : parse_hr_stream();
+  if (parsed == std::nullopt) {
+    return;
+  }
+
+  if (SubjectCache::write(_hr_file_path, start_epoch.value(), HR_SAMPLE_FREQ,
+                          {&parsed.value()}, false)) {
+    _hr_cache = SubjectCache(_hr_file_path, 1);
+  } else {
+    logger.log_warning(warnings::WARNINGS::CACHE_NOT_WRITTEN,
+                       "(" + _hr_file_path + ")");
+  }
+}
+
+bool SubjectDataProcessor::parse_field_value(const char*& cursor,
+                                             const char* line_end,
+                                             float_t& value) noexcept {
+  while (cursor < line_end && (*cursor == ' ' || *cursor == '\t')) {
+    ++cursor;
+  }
+
+  if (cursor < line_end && *cursor == '+') {  // Not accepted by from_chars
+    ++cursor;
+  }
+
+  int parsed = 0;
+  const std::from_chars_result result =
+      std::from_chars(cursor, line_end, parsed);
+  if (result.ec != std::errc()) {
+    return false;
+  }
+
+  value = (float_t)parsed;
+  cursor = std::find(result.ptr, line_end, DATA_DELIMITER);
+
+  return true;
+}
+
+const char* SubjectDataProcessor::skip_lines(const char* cursor,
+                                             const char* end,
+                                             const u_long count) noexcept {
+  for (u_long i = 0; i < count && cursor < end; ++i) {
+    const void* line_end = std::memchr(cursor, '\n', end - cursor);
+    cursor = line_end == nullptr ? end : static_cast<const char*>(line_end) + 1;
+  }
+
+  return cursor;
+}
+
 const std::optional<std::array<float_t, ACC_NO_VALUES>>
 SubjectDataProcessor::parse_acc_value(
     std::string& value_string) const noexcept {
@@ -94,9 +297,689 @@ SubjectDataProcessor::parse_acc_value(
   return rv;
 }
 
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2,bmi,popcnt"))) bool
+SubjectDataProcessor::parse_acc_line_avx2(
+    const char* line, std::array<float_t, ACC_NO_VALUES>& values,
+    const char*& next_line) noexcept {
+  // Bytes loaded below - every other read stays inside them as well
+  const size_t LOADED_BYTES = 64;
+  static_assert(ACC_SIMD_LINE_WINDOW >= 64,
+                "The SIMD tokenizer loads 64 bytes of every line");
+
+  const __m256i delimiters = _mm256_set1_epi8(DATA_DELIMITER);
+  const __m256i newlines = _mm256_set1_epi8('\n');
+
+  // Two 32 byte blocks cover any regular ACC line (~45 characters)
+  const __m256i low =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line));
+  const __m256i high =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + 32));
+
+  const uint64_t delimiter_mask =
+      (uint64_t)(uint32_t)_mm256_movemask_epi8(
+          _mm256_cmpeq_epi8(low, delimiters)) |
+      ((uint64_t)(uint32_t)_mm256_movemask_epi8(
+           _mm256_cmpeq_epi8(high, delimiters))
+       << 32);
+  const uint64_t newline_mask =
+      (uint64_t)(uint32_t)_mm256_movemask_epi8(
+          _mm256_cmpeq_epi8(low, newlines)) |
+      ((uint64_t)(uint32_t)_mm256_movemask_epi8(
+           _mm256_cmpeq_epi8(high, newlines))
+       << 32);
+
+  if (newline_mask == 0) {  // Line does not fit into the window
+    return false;
+  }
+
+  const uint64_t line_len = _tzcnt_u64(newline_mask);
+  uint64_t fields = delimiter_mask & ((1ULL << line_len) - 1);
+
+  if (_mm_popcnt_u64(fields) != ACC_NO_VALUES) {
+    return false;
+  }
+
+  bool valid = true;
+  for (size_t i = 0; i < ACC_NO_VALUES; ++i) {
+    const char* field = line + _tzcnt_u64(fields) + 1;
+    fields = _blsr_u64(fields);
+
+    const uint32_t negative = field[0] == '-';
+    const char* digits = field + negative;
+
+    // A malformed line may end with a delimiter right before the newline
+    if (digits + 4 > line + LOADED_BYTES) {
+      return false;
+    }
+
+    const uint32_t d0 = (uint8_t)(digits[0] - '0');
+    const uint32_t d1 = (uint8_t)(digits[1] - '0');
+    const uint32_t d2 = (uint8_t)(digits[2] - '0');
+    const uint32_t d3 = (uint8_t)(digits[3] - '0');
+
+    // Number of leading digits = number of trailing ones in the mask
+    const uint32_t digit_mask = (uint32_t)(d0 < 10) |
+                                (uint32_t)(d1 < 10) << 1 |
+                                (uint32_t)(d2 < 10) << 2 |
+                                (uint32_t)(d3 < 10) << 3;
+    const uint32_t count = _tzcnt_u32(~digit_mask);
+    valid &= count - 1 < 3;  // 1 to 3 digits, int8 range
+
+    // Selects compile down to conditional moves
+    const uint32_t two_digits = d0 * 10 + d1;
+    const uint32_t three_digits = two_digits * 10 + d2;
+    const int32_t value =
+        (int32_t)(count == 3 ? three_digits : (count == 2 ? two_digits : d0));
+
+    values[i] = (float_t)(negative ? -value : value);
+  }
+
+  next_line = line + line_len + 1;
+
+  return valid;
+}
+#else
+bool SubjectDataProcessor::parse_acc_line_avx2(
+    const char*, std::array<float_t, ACC_NO_VALUES>&, const char*&) noexcept {
+  return false;
+}
+#endif
+
 const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
 SubjectDataProcessor::parse_acc_file(const uint8_t period_size,
                                      const u_long timestamp_diff) noexcept {
+  if (_use_acc_cache && !_acc_cache.is_valid()) {
+    build_acc_cache();
+  }
+
+  if (_acc_cache.is_valid()) {
+    if (period_size == 0) {
+      logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
+                       "(Provided value: " + std::to_string(period_size) + ")");
+      return std::nullopt;
+    }
+
+    u_long diff = (long)((timestamp_diff * HR_SAMPLE_FREQ) / period_size);
+    logger.log_info("Loading ACC values from cache " +
+                    SubjectCache::cache_path(_acc_file_path) + " (skipping " +
+                    std::to_string(diff) + " lines)");
+
+    return std::array<std::vector<float_t>, ACC_NO_VALUES>{
+        _acc_cache.column_values(0, diff), _acc_cache.column_values(1, diff),
+        _acc_cache.column_values(2, diff)};
+  }
+
+  if (_acc_compression != COMPRESSION::NONE) {
+    return parse_acc_compressed(period_size, timestamp_diff);
+  }
+
+  if (_reader != INPUT_READER::STREAM) {
+    return parse_acc_buffer(period_size, timestamp_diff);
+  }
+
+  return parse_acc_stream(period_size, timestamp_diff);
+}
+
+template <typename LineSink>
+bool SubjectDataProcessor::parse_acc_range(const char* cursor,
+                                           const char* const end,
+                                           LineSink& sink, std::string& error,
+                                           const bool log_progress)
+    const noexcept {
+  const size_t LOGGING_THRESHOLD = 1000000;
+
+  std::array<float_t, ACC_NO_VALUES> curr_vals = {0, 0, 0};  // X, Y, Z
+  u_long lines = 0;
+
+  const bool use_simd =
+      _reader == INPUT_READER::MMAP && avx::cpu_supports_avx2();
+  const char* const simd_end =
+      end - std::min<size_t>(end - cursor, ACC_SIMD_LINE_WINDOW);
+
+  while (cursor < end) {
+    const char* simd_next_line = nullptr;
+    if (use_simd && cursor < simd_end &&
+        parse_acc_line_avx2(cursor, curr_vals, simd_next_line)) {
+      sink(curr_vals);
+
+      if (log_progress && ++lines % LOGGING_THRESHOLD == 0) {
+        logger.log_info("Parsed " + std::to_string(lines) +
+                        " lines in current ACC file");
+      };
+
+      cursor = simd_next_line;
+      continue;
+    }
+
+    const void* newline = std::memchr(cursor, '\n', end - cursor);
+    const char* line_end =
+        newline == nullptr ? end : static_cast<const char*>(newline);
+    const char* next_line = line_end == end ? end : line_end + 1;
+
+    if (line_end > cursor && *(line_end - 1) == '\r') {
+      --line_end;
+    }
+
+    if (line_end == cursor) {  // Empty line
+      cursor = next_line;
+      continue;
+    }
+
+    // We do not care about parsing the timestamps
+    const char* pos = std::find(cursor, line_end, DATA_DELIMITER);
+
+    for (size_t i = 0; i < ACC_NO_VALUES; ++i) {
+      if (pos == line_end) {
+        error = "ACC files must have the following structure: "
+                "datetime,acc_x,acc_y,acc_z (Line: " +
+                std::string(cursor, line_end) + ")";
+        return false;
+      }
+
+      ++pos;  // Skip the delimiter
+
+      if (!parse_field_value(pos, line_end, curr_vals[i])) {
+        error = "(Value: " + std::string(pos, line_end) + ")";
+        return false;
+      }
+    }
+
+    sink(curr_vals);
+
+    if (log_progress && ++lines % LOGGING_THRESHOLD == 0) {
+      logger.log_info("Parsed " + std::to_string(lines) +
+                      " lines in current ACC file");
+    };
+
+    cursor = next_line;
+  }
+
+  return true;
+}
+
+const char* SubjectDataProcessor::acc_data_begin(
+    const uint8_t period_size, const u_long timestamp_diff) const noexcept {
+  const char* cursor = _acc_file_map.begin();
+  const char* const end = _acc_file_map.end();
+
+  cursor = skip_lines(cursor, end, 1);  // Skip the first line
+
+  // Sync up with HR measurements. Has to happen before the file is split into chunks
+  u_long diff = (long)((timestamp_diff * HR_SAMPLE_FREQ) / period_size);
+  if (diff > 0) {
+    logger.log_info("ACC measurements are \"ahead\" by " +
+                    std::to_string(diff) + " lines. Skipping...");
+  }
+
+  return skip_lines(cursor, end, diff);
+}
+
+std::vector<const char*> SubjectDataProcessor::split_into_chunks(
+    const char* cursor, const char* const end) const noexcept {
+  // Below this size, spawning threads costs more than it saves
+  const size_t MIN_PARALLEL_CHUNK_SIZE = 1 << 20;
+
+  const size_t range_size = end - cursor;
+  const size_t chunks_count = std::max<size_t>(
+      1, std::min<size_t>(_parse_threads, range_size / MIN_PARALLEL_CHUNK_SIZE));
+
+  // Split the byte range into chunks, each beginning right after a newline
+  std::vector<const char*> bounds(chunks_count + 1, end);
+  bounds[0] = cursor;
+  for (size_t i = 1; i < chunks_count; ++i) {
+    bounds[i] = std::max(bounds[i - 1],
+                         skip_lines(cursor + range_size * i / chunks_count -
+                                        1,  // -1 to keep a chunk that begins exactly at a line
+                                    end, 1));
+  }
+
+  return bounds;
+}
+
+size_t SubjectDataProcessor::count_data_lines(const char* cursor,
+                                              const char* const end) noexcept {
+  size_t lines = 0;
+
+  while (cursor < end) {
+    const void* newline = std::memchr(cursor, '\n', end - cursor);
+    const char* line_end =
+        newline == nullptr ? end : static_cast<const char*>(newline);
+
+    // Same notion of an empty line as in parse_acc_range
+    const size_t line_len = line_end - cursor;
+    lines += line_len > 1 || (line_len == 1 && *cursor != '\r');
+
+    cursor = line_end == end ? end : line_end + 1;
+  }
+
+  return lines;
+}
+
+void SubjectDataProcessor::run_on_chunks(
+    const size_t chunks_count,
+    const std::function<void(const size_t)>& task) const noexcept {
+  if (chunks_count == 1) {
+    task(0);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  workers.reserve(chunks_count);
+  for (size_t i = 0; i < chunks_count; ++i) {
+    workers.emplace_back(task, i);
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
+SubjectDataProcessor::parse_acc_buffer(const uint8_t period_size,
+                                       const u_long timestamp_diff) noexcept {
+  if (period_size == 0) {
+    logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
+                     "(Provided value: " + std::to_string(period_size) + ")");
+    return std::nullopt;
+  }
+
+  logger.log_info("Beginning parsing file " + _acc_file_path);
+
+  const std::vector<const char*> bounds = split_into_chunks(
+      acc_data_begin(period_size, timestamp_diff), _acc_file_map.end());
+  const size_t chunks_count = bounds.size() - 1;
+
+  std::vector<std::array<std::vector<float_t>, ACC_NO_VALUES>> chunk_values(
+      chunks_count);
+  std::vector<std::string> chunk_errors(chunks_count);
+  std::vector<uint8_t> chunk_results(chunks_count, false);
+
+  if (chunks_count > 1) {
+    logger.log_info("Parsing in " + std::to_string(chunks_count) +
+                    " parallel chunks");
+  }
+
+  run_on_chunks(chunks_count, [this, &bounds, &chunk_values, &chunk_errors,
+                               &chunk_results, chunks_count](const size_t i) {
+    std::array<std::vector<float_t>, ACC_NO_VALUES>& values = chunk_values[i];
+
+    // Exact number of lines in the chunk, so that the vectors never reallocate
+    const size_t expected_lines =
+        std::count(bounds[i], bounds[i + 1], '\n') + 1;
+    for (std::vector<float_t>& axis : values) {
+      axis.reserve(expected_lines);
+    }
+
+    const auto append_line =
+        [&values](const std::array<float_t, ACC_NO_VALUES>& line) {
+          values[0].push_back(line[0]);
+          values[1].push_back(line[1]);
+          values[2].push_back(line[2]);
+        };
+
+    chunk_results[i] = parse_acc_range(bounds[i], bounds[i + 1], append_line,
+                                       chunk_errors[i], chunks_count == 1);
+  });
+
+  for (size_t i = 0; i < chunks_count; ++i) {
+    if (!chunk_results[i]) {
+      logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE, chunk_errors[i]);
+      logger.log_warning(warnings::WARNINGS::ACC_VALUE_NOT_PARSED);
+      return std::nullopt;
+    }
+  }
+
+  std::array<std::vector<float_t>, ACC_NO_VALUES> results =
+      std::move(chunk_values[0]);
+
+  if (chunks_count > 1) {
+    // Concatenate the chunks in order
+    std::vector<size_t> offsets(chunks_count + 1, 0);
+    for (size_t i = 0; i < chunks_count; ++i) {
+      offsets[i + 1] = offsets[i] + (i == 0 ? results[0].size()
+                                            : chunk_values[i][0].size());
+    }
+
+    for (std::vector<float_t>& axis : results) {
+      axis.resize(offsets[chunks_count]);
+    }
+
+    std::vector<size_t> chunk_ids(chunks_count - 1);
+    std::iota(chunk_ids.begin(), chunk_ids.end(), 1);
+    std::for_each(std::execution::par, chunk_ids.begin(), chunk_ids.end(),
+                  [&results, &chunk_values, &offsets](const size_t i) {
+                    for (size_t axis = 0; axis < ACC_NO_VALUES; ++axis) {
+                      std::copy(chunk_values[i][axis].begin(),
+                                chunk_values[i][axis].end(),
+                                results[axis].begin() + offsets[i]);
+                      chunk_values[i][axis] = std::vector<float_t>();
+                    }
+                  });
+  }
+
+  logger.log_info("Parsed " + std::to_string(results[0].size()) +
+                  " lines from " + _acc_file_path);
+
+  logger.log_debug("Values X size: " + std::to_string(results[0].size()));
+  logger.log_debug("Values Y size: " + std::to_string(results[1].size()));
+  logger.log_debug("Values Z size: " + std::to_string(results[2].size()));
+
+  return results;
+}
+
+std::optional<std::array<SubjectSeries, ACC_NO_VALUES>>
+SubjectDataProcessor::parse_acc_normalized(
+    const uint8_t period_size, const u_long timestamp_diff) noexcept {
+  if (period_size == 0) {
+    logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
+                     "(Provided value: " + std::to_string(period_size) + ")");
+    return std::nullopt;
+  }
+
+  const size_t NORMALIZATION_PERIOD = ACC_SAMPLE_FREQ * period_size;
+
+  logger.log_info("Beginning parsing and normalizing file " + _acc_file_path);
+
+  const std::vector<const char*> bounds = split_into_chunks(
+      acc_data_begin(period_size, timestamp_diff), _acc_file_map.end());
+  const size_t chunks_count = bounds.size() - 1;
+
+  // Every chunk needs to know the index of its first line to accumulate into the right periods
+  std::vector<size_t> line_offsets(chunks_count + 1, 0);
+  run_on_chunks(chunks_count, [&bounds, &line_offsets](const size_t i) {
+    line_offsets[i + 1] = count_data_lines(bounds[i], bounds[i + 1]);
+  });
+  std::partial_sum(line_offsets.begin(), line_offsets.end(),
+                   line_offsets.begin());
+
+  const size_t lines = line_offsets[chunks_count];
+
+  // Sums of the periods touched by each chunk. A period may be split between two neighbouring chunks
+  std::vector<std::array<std::vector<float_t>, ACC_NO_VALUES>> chunk_sums(
+      chunks_count);
+  std::vector<std::string> chunk_errors(chunks_count);
+  std::vector<uint8_t> chunk_results(chunks_count, false);
+
+  run_on_chunks(chunks_count, [this, &bounds, &line_offsets, &chunk_sums,
+                               &chunk_errors, &chunk_results, chunks_count,
+                               NORMALIZATION_PERIOD](const size_t i) {
+    std::array<std::vector<float_t>, ACC_NO_VALUES>& sums = chunk_sums[i];
+
+    const size_t first_period = line_offsets[i] / NORMALIZATION_PERIOD;
+    const size_t last_period = line_offsets[i + 1] / NORMALIZATION_PERIOD;
+    for (std::vector<float_t>& axis : sums) {
+      axis.assign(last_period - first_period + 1, 0.0f);
+    }
+
+    size_t period = 0;
+    size_t in_period = line_offsets[i] % NORMALIZATION_PERIOD;
+    size_t parsed_lines = 0;
+
+    const auto accumulate_line =
+        [&sums, &period, &in_period, &parsed_lines, NORMALIZATION_PERIOD,
+         &line_offsets, i](const std::array<float_t, ACC_NO_VALUES>& line) {
+          if (line_offsets[i] + parsed_lines++ >= line_offsets[i + 1]) {
+            return;  // Counted and parsed lines disagree, reported below
+          }
+
+          sums[0][period] += line[0];
+          sums[1][period] += line[1];
+          sums[2][period] += line[2];
+
+          if (++in_period == NORMALIZATION_PERIOD) {
+            in_period = 0;
+            ++period;
+          }
+        };
+
+    chunk_results[i] =
+        parse_acc_range(bounds[i], bounds[i + 1], accumulate_line,
+                        chunk_errors[i], chunks_count == 1);
+
+    if (chunk_results[i] &&
+        parsed_lines != line_offsets[i + 1] - line_offsets[i]) {
+      chunk_errors[i] = "(Line count mismatch in chunk " + std::to_string(i) +
+                        ")";
+      chunk_results[i] = false;
+    }
+  });
+
+  for (size_t i = 0; i < chunks_count; ++i) {
+    if (!chunk_results[i]) {
+      logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE, chunk_errors[i]);
+      logger.log_warning(warnings::WARNINGS::ACC_VALUE_NOT_PARSED);
+      return std::nullopt;
+    }
+  }
+
+  logger.log_info("Parsed " + std::to_string(lines) + " lines from " +
+                  _acc_file_path);
+
+  // Same layout as normalize_acc_values - the last period may be incomplete
+  std::array<SubjectSeries, ACC_NO_VALUES> normalized;
+  for (SubjectSeries& axis : normalized) {
+    axis = SubjectSeries(lines / NORMALIZATION_PERIOD + 1, 0.0f);
+  }
+
+  for (size_t i = 0; i < chunks_count; ++i) {
+    const size_t first_period = line_offsets[i] / NORMALIZATION_PERIOD;
+    for (size_t axis = 0; axis < ACC_NO_VALUES; ++axis) {
+      for (size_t j = 0; j < chunk_sums[i][axis].size() &&
+                         first_period + j < normalized[axis].size();
+           ++j) {
+        normalized[axis][first_period + j] += chunk_sums[i][axis][j];
+      }
+    }
+  }
+
+  const uint8_t ACC_MAX_VALUE = 127;
+  for (SubjectSeries& axis : normalized) {
+    for (float_t& value : axis) {
+      value /= NORMALIZATION_PERIOD * ACC_MAX_VALUE;
+    }
+  }
+
+  logger.log_debug("Normalized ACC values count: " +
+                   std::to_string(normalized[0].size()));
+
+  return normalized;
+}
+
+std::optional<std::vector<char>> SubjectDataProcessor::encode_acc_buffer()
+    noexcept {
+  logger.log_info("Beginning parsing file " + _acc_file_path + " into cache");
+
+  const std::vector<const char*> bounds =
+      split_into_chunks(acc_data_begin(1, 0), _acc_file_map.end());
+  const size_t chunks_count = bounds.size() - 1;
+
+  // Every chunk writes its lines right after the lines of the previous chunks
+  std::vector<size_t> line_offsets(chunks_count + 1, 0);
+  run_on_chunks(chunks_count, [&bounds, &line_offsets](const size_t i) {
+    line_offsets[i + 1] = count_data_lines(bounds[i], bounds[i + 1]);
+  });
+  std::partial_sum(line_offsets.begin(), line_offsets.end(),
+                   line_offsets.begin());
+
+  const size_t lines = line_offsets[chunks_count];
+
+  std::vector<char> encoded(ACC_NO_VALUES * lines);
+  std::vector<std::string> chunk_errors(chunks_count);
+  std::vector<uint8_t> chunk_results(chunks_count, false);
+  std::vector<uint8_t> chunk_fits(chunks_count, true);
+
+  run_on_chunks(chunks_count, [this, &bounds, &line_offsets, &encoded,
+                               &chunk_errors, &chunk_results, &chunk_fits,
+                               chunks_count, lines](const size_t i) {
+    size_t line = line_offsets[i];
+    uint8_t& fits = chunk_fits[i];
+
+    const auto encode_line =
+        [&encoded, &line, &fits, &line_offsets, i,
+         lines](const std::array<float_t, ACC_NO_VALUES>& values) {
+          if (line >= line_offsets[i + 1]) {
+            ++line;
+            return;  // Counted and parsed lines disagree, reported below
+          }
+
+          for (size_t axis = 0; axis < ACC_NO_VALUES; ++axis) {
+            if (values[axis] < INT8_MIN || values[axis] > INT8_MAX) {
+              fits = false;
+            }
+            encoded[axis * lines + line] = (char)(int8_t)values[axis];
+          }
+          ++line;
+        };
+
+    chunk_results[i] = parse_acc_range(bounds[i], bounds[i + 1], encode_line,
+                                       chunk_errors[i], chunks_count == 1);
+
+    if (chunk_results[i] && line != line_offsets[i + 1]) {
+      chunk_errors[i] = "(Line count mismatch in chunk " + std::to_string(i) +
+                        ")";
+      chunk_results[i] = false;
+    }
+  });
+
+  for (size_t i = 0; i < chunks_count; ++i) {
+    if (!chunk_results[i]) {
+      logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE, chunk_errors[i]);
+      logger.log_warning(warnings::WARNINGS::ACC_VALUE_NOT_PARSED);
+      return std::nullopt;
+    }
+
+    if (!chunk_fits[i]) {
+      logger.log_debug("Values of " + _acc_file_path +
+                       " do not fit into the cache");
+      return std::nullopt;
+    }
+  }
+
+  logger.log_info("Parsed " + std::to_string(lines) + " lines from " +
+                  _acc_file_path);
+
+  return encoded;
+}
+
+std::optional<std::array<SubjectSeries, ACC_NO_VALUES>>
+SubjectDataProcessor::normalize_acc_cache(
+    const uint8_t period_size, const u_long timestamp_diff) const noexcept {
+  if (period_size == 0) {
+    logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
+                     "(Provided value: " + std::to_string(period_size) + ")");
+    return std::nullopt;
+  }
+
+  const size_t NORMALIZATION_PERIOD = ACC_SAMPLE_FREQ * period_size;
+  const uint8_t ACC_MAX_VALUE = 127;
+
+  const u_long diff = (long)((timestamp_diff * HR_SAMPLE_FREQ) / period_size);
+  const size_t count = _acc_cache.header().count;
+  const size_t lines = count > diff ? count - diff : 0;
+
+  logger.log_info("Normalizing ACC values from cache " +
+                  SubjectCache::cache_path(_acc_file_path) + " (skipping " +
+                  std::to_string(diff) + " lines)");
+
+  std::array<SubjectSeries, ACC_NO_VALUES> normalized;
+  for (size_t axis = 0; axis < ACC_NO_VALUES; ++axis) {
+    const int8_t* values =
+        reinterpret_cast<const int8_t*>(_acc_cache.column_data(axis)) +
+        (count - lines);
+
+    normalized[axis] = SubjectSeries(lines / NORMALIZATION_PERIOD + 1, 0.0f);
+
+    // Every period is summed by exactly one worker
+    SubjectSeries& axis_values = normalized[axis];
+    std::for_each(std::execution::par, axis_values.begin(), axis_values.end(),
+                  [&axis_values, values, lines,
+                   NORMALIZATION_PERIOD](float_t& value) {
+                    const size_t begin =
+                        (&value - &axis_values[0]) * NORMALIZATION_PERIOD;
+                    const size_t end =
+                        std::min(begin + NORMALIZATION_PERIOD, lines);
+
+                    int32_t sum = 0;
+                    for (size_t i = begin; i < end; ++i) {
+                      sum += values[i];
+                    }
+
+                    value = (float_t)sum /
+                            (float_t)(NORMALIZATION_PERIOD * ACC_MAX_VALUE);
+                  });
+  }
+
+  logger.log_debug("Normalized ACC values count: " +
+                   std::to_string(normalized[0].size()));
+
+  return normalized;
+}
+
+const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
+SubjectDataProcessor::parse_acc_compressed(
+    const uint8_t period_size, const u_long timestamp_diff) noexcept {
+  if (period_size == 0) {
+    logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
+                     "(Provided value: " + std::to_string(period_size) + ")");
+    return std::nullopt;
+  }
+
+  // Sync up with HR measurements
+  u_long diff = (long)((timestamp_diff * HR_SAMPLE_FREQ) / period_size);
+  if (diff > 0) {
+    logger.log_info("ACC measurements are \"ahead\" by " +
+                    std::to_string(diff) + " lines. Skipping...");
+  }
+
+  logger.log_info("Beginning parsing compressed file " + _acc_file_path);
+
+  std::array<std::vector<float_t>, ACC_NO_VALUES> values;
+  const auto append_line =
+      [&values](const std::array<float_t, ACC_NO_VALUES>& line) {
+        values[0].push_back(line[0]);
+        values[1].push_back(line[1]);
+        values[2].push_back(line[2]);
+      };
+
+  u_long lines_to_skip = diff + 1;  // +1 for the csv header line
+  std::string error;
+  bool parsed = true;
+
+  // Decompression of the next blocks overlaps with the parsing of this one
+  StreamingDecompressor decompressor(_acc_file_path);
+  const bool decompressed = decompressor.read_lines(
+      [this, &append_line, &lines_to_skip, &error, &parsed](
+          const char* cursor, const char* const end) {
+        for (; lines_to_skip > 0 && cursor < end; --lines_to_skip) {
+          cursor = skip_lines(cursor, end, 1);
+        }
+
+        parsed = parse_acc_range(cursor, end, append_line, error, false);
+        return parsed;
+      });
+
+  if (!decompressed) {
+    logger.log_error(errors::ERRORS::COULD_NOT_DECOMPRESS_FILE,
+                     decompressor.error());
+    return std::nullopt;
+  }
+
+  if (!parsed) {
+    logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE, error);
+    logger.log_warning(warnings::WARNINGS::ACC_VALUE_NOT_PARSED);
+    return std::nullopt;
+  }
+
+  logger.log_info("Parsed " + std::to_string(values[0].size()) +
+                  " lines from " + _acc_file_path);
+
+  return values;
+}
+
+const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
+SubjectDataProcessor::parse_acc_stream(const uint8_t period_size,
+                                       const u_long timestamp_diff) noexcept {
   if (period_size == 0) {
     logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
                      "(Provided value: " + std::to_string(period_size) + ")");
@@ -116,6 +999,7 @@ SubjectDataProcessor::parse_acc_file(const uint8_t period_size,
 
   logger.log_info("Beginning parsing file " + _acc_file_path);
 
+  _acc_file_stream.clear();  // May have been read to its end already
   _acc_file_stream.seekg(_acc_file_stream.beg);
   std::getline(_acc_file_stream, curr_line);  //Skip the first line
 
@@ -141,7 +1025,7 @@ SubjectDataProcessor::parse_acc_file(const uint8_t period_size,
       return std::nullopt;
     }
 
-    /* auto timestamp = parse_datetime(curr_line.substr(0, pos), DATETIME_FORMAT); */  // We do not care about parsing the timestamps anymore
+    // The timestamps are decoded separately, see parse_acc_timestamps()
     curr_line.erase(0, pos + 1);  // +1 to delete the delimiter as well
 
     parsed = parse_acc_value(curr_line);
@@ -166,18 +1050,186 @@ SubjectDataProcessor::parse_acc_file(const uint8_t period_size,
   logger.log_info("Parsed " + std::to_string(lines) + " lines from " +
                   _acc_file_path);
 
-  std::array<std::vector<float_t>, ACC_NO_VALUES> results = {values_x, values_y,
-                                                             values_z};
+  std::array<std::vector<float_t>, ACC_NO_VALUES> results = {
+      std::move(values_x), std::move(values_y), std::move(values_z)};
 
-  logger.log_debug("Values X size: " + std::to_string(values_x.size()));
-  logger.log_debug("Values Y size: " + std::to_string(values_y.size()));
-  logger.log_debug("Values Z size: " + std::to_string(values_z.size()));
+  logger.log_debug("Values X size: " + std::to_string(results[0].size()));
+  logger.log_debug("Values Y size: " + std::to_string(results[1].size()));
+  logger.log_debug("Values Z size: " + std::to_string(results[2].size()));
 
   return results;
 }
 
 const std::optional<std::vector<float_t>> SubjectDataProcessor::parse_hr_file(
     const uint8_t period_size, const u_long timestamp_diff) noexcept {
+  if (_use_hr_cache && !_hr_cache.is_valid()) {
+    build_hr_cache();
+  }
+
+  if (_hr_cache.is_valid()) {
+    if (period_size == 0) {
+      logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
+                       "(Provided value: " + std::to_string(period_size) + ")");
+      return std::nullopt;
+    }
+
+    u_long diff = (long)((timestamp_diff * HR_SAMPLE_FREQ) / period_size);
+    logger.log_info("Loading HR values from cache " +
+                    SubjectCache::cache_path(_hr_file_path) + " (skipping " +
+                    std::to_string(diff) + " lines)");
+
+    return _hr_cache.column_values(0, diff);
+  }
+
+  if (_hr_compression != COMPRESSION::NONE) {
+    return parse_hr_compressed(period_size, timestamp_diff);
+  }
+
+  if (_reader != INPUT_READER::STREAM) {
+    return parse_hr_buffer(period_size, timestamp_diff);
+  }
+
+  return parse_hr_stream(period_size, timestamp_diff);
+}
+
+bool SubjectDataProcessor::parse_hr_range(const char* cursor,
+                                          const char* const end,
+                                          std::vector<float_t>& values,
+                                          std::string& error) noexcept {
+  const size_t LOGGING_THRESHOLD = 100000;
+
+  float_t curr_val = 0.0f;
+
+  while (cursor < end) {
+    const void* newline = std::memchr(cursor, '\n', end - cursor);
+    const char* line_end =
+        newline == nullptr ? end : static_cast<const char*>(newline);
+    const char* next_line = line_end == end ? end : line_end + 1;
+
+    if (line_end > cursor && *(line_end - 1) == '\r') {
+      --line_end;
+    }
+
+    if (line_end == cursor) {  // Empty line
+      cursor = next_line;
+      continue;
+    }
+
+    const char* pos = std::find(cursor, line_end, DATA_DELIMITER);
+    if (pos == line_end) {
+      error = "HR files need to have the following structure: "
+              "<datetime,hr> (Line: " +
+              std::string(cursor, line_end) + ")";
+      return false;
+    }
+
+    ++pos;  // Skip the delimiter
+
+    if (!parse_field_value(pos, line_end, curr_val)) {
+      error = "(Value: " + std::string(pos, line_end) + ")";
+      return false;
+    }
+
+    // Same narrowing as in the stream variant
+    values.push_back((uint8_t)(int)curr_val);
+
+    if (values.size() % LOGGING_THRESHOLD == 0) {
+      logger.log_info("Parsed " + std::to_string(values.size()) +
+                      " in the current HR file");
+    }
+
+    cursor = next_line;
+  }
+
+  return true;
+}
+
+const std::optional<std::vector<float_t>> SubjectDataProcessor::parse_hr_buffer(
+    const uint8_t period_size, const u_long timestamp_diff) noexcept {
+  if (period_size == 0) {
+    logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
+                     "(Provided value: " + std::to_string(period_size) + ")");
+    return std::nullopt;
+  }
+
+  const char* cursor = _hr_file_map.begin();
+  const char* const end = _hr_file_map.end();
+
+  cursor = skip_lines(cursor, end, 1);  // Skip the first csv header line
+
+  // Sync up with accelerometer measurements
+  u_long diff = (long)((timestamp_diff * HR_SAMPLE_FREQ) / period_size);
+  if (diff > 0) {
+    logger.log_info("HR measurements are \"ahead\" by " + std::to_string(diff) +
+                    " lines. Skipping...");
+  }
+  cursor = skip_lines(cursor, end, diff);
+
+  logger.log_info("Beginning parsing file " + _hr_file_path);
+
+  std::vector<float_t> values;
+  values.reserve(std::count(cursor, end, '\n') + 1);
+
+  std::string error;
+  if (!parse_hr_range(cursor, end, values, error)) {
+    logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE, error);
+    return std::nullopt;
+  }
+
+  return values;
+}
+
+const std::optional<std::vector<float_t>>
+SubjectDataProcessor::parse_hr_compressed(
+    const uint8_t period_size, const u_long timestamp_diff) noexcept {
+  if (period_size == 0) {
+    logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
+                     "(Provided value: " + std::to_string(period_size) + ")");
+    return std::nullopt;
+  }
+
+  // Sync up with accelerometer measurements
+  u_long diff = (long)((timestamp_diff * HR_SAMPLE_FREQ) / period_size);
+  if (diff > 0) {
+    logger.log_info("HR measurements are \"ahead\" by " + std::to_string(diff) +
+                    " lines. Skipping...");
+  }
+
+  logger.log_info("Beginning parsing compressed file " + _hr_file_path);
+
+  std::vector<float_t> values;
+  u_long lines_to_skip = diff + 1;  // +1 for the csv header line
+  std::string error;
+  bool parsed = true;
+
+  StreamingDecompressor decompressor(_hr_file_path);
+  const bool decompressed = decompressor.read_lines(
+      [&values, &lines_to_skip, &error, &parsed](const char* cursor,
+                                                 const char* const end) {
+        for (; lines_to_skip > 0 && cursor < end; --lines_to_skip) {
+          cursor = skip_lines(cursor, end, 1);
+        }
+
+        parsed = parse_hr_range(cursor, end, values, error);
+        return parsed;
+      });
+
+  if (!decompressed) {
+    logger.log_error(errors::ERRORS::COULD_NOT_DECOMPRESS_FILE,
+                     decompressor.error());
+    return std::nullopt;
+  }
+
+  if (!parsed) {
+    logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE, error);
+    return std::nullopt;
+  }
+
+  return values;
+}
+
+const std::optional<std::vector<float_t>> SubjectDataProcessor::parse_hr_stream(
+    const uint8_t period_size, const u_long timestamp_diff) noexcept {
   if (period_size == 0) {
     logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
                      "(Provided value: " + std::to_string(period_size) + ")");
@@ -192,6 +1244,7 @@ const std::optional<std::vector<float_t>> SubjectDataProcessor::parse_hr_file(
 
   curr_line.reserve(MAX_LINE_LEN);
   tmp.reserve(MAX_VAL_STR_LEN);
+  _hr_file_stream.clear();  // May have been read to its end already
   _hr_file_stream.seekg(_hr_file_stream.beg);
   std::getline(_hr_file_stream, curr_line);  // Skip the first csv header line
 
@@ -236,30 +1289,32 @@ const std::optional<std::vector<float_t>> SubjectDataProcessor::parse_hr_file(
   return values;
 }
 
-std::vector<float_t> SubjectDataProcessor::normalize_acc_values(
-    const std::uint8_t period_size,
-    const std::vector<float_t>& values) const noexcept {
+SubjectSeries SubjectDataProcessor::normalize_acc_values(
+    const std::uint8_t period_size, const SeriesView values) const noexcept {
   if (period_size == 0) {
     logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
                      "(Provided value: " + std::to_string(period_size) + ")");
-    return std::vector<float_t>();
+    return SubjectSeries();
   }
 
   const size_t NORMALIZATION_PERIOD = ACC_SAMPLE_FREQ * period_size;
 
-  std::vector<float_t> rv(values.size() / NORMALIZATION_PERIOD + 1, 0.0f);
+  SubjectSeries rv(values.size() / NORMALIZATION_PERIOD + 1, 0.0f);
 
   logger.log_info("Beginning normalizing ACC values... ");
 
-  std::for_each(std::execution::par, values.begin(), values.end(),
-                [&rv, &values, NORMALIZATION_PERIOD](float_t const& value) {
-                  size_t index = (&value - &values[0]) / NORMALIZATION_PERIOD;
-                  rv[index] += value;
-                });
-
+  // Every period is summed by exactly one worker, in a fixed order, so the
+  // result does not depend on the number of threads
   const uint8_t ACC_MAX_VALUE = 127;
-  std::for_each(std::execution::par_unseq, rv.begin(), rv.end(),
-                [NORMALIZATION_PERIOD](float_t& value) {
+  std::for_each(std::execution::par, rv.begin(), rv.end(),
+                [&rv, &values, NORMALIZATION_PERIOD](float_t& value) {
+                  const size_t begin = (&value - &rv[0]) * NORMALIZATION_PERIOD;
+                  const size_t end =
+                      std::min(begin + NORMALIZATION_PERIOD, values.size());
+
+                  value = begin < end ? avx::segment_sum(values.data() + begin,
+                                                         end - begin)
+                                      : 0.0f;
                   value /= NORMALIZATION_PERIOD * ACC_MAX_VALUE;
                 });
 
@@ -268,50 +1323,43 @@ std::vector<float_t> SubjectDataProcessor::normalize_acc_values(
   return rv;
 }
 
-std::vector<float_t> SubjectDataProcessor::normalize_hr_values(
-    const uint8_t period_size,
-    const std::vector<float_t>& values) const noexcept {
+SubjectSeries SubjectDataProcessor::normalize_hr_values(
+    const uint8_t period_size, const SeriesView values) const noexcept {
 
   if (period_size == 0) {
     logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
                      "(Provided value: " + std::to_string(period_size) + ")");
-    return std::vector<float_t>();
+    return SubjectSeries();
   }
 
-  std::vector<float_t> rv(values.size() / period_size, 0.0f);
+  SubjectSeries rv(values.size() / period_size, 0.0f);
 
-  std::for_each(std::execution::par, values.begin(), values.end(),
-                [&rv, &values, period_size](float_t const& value) {
-                  size_t index = (&value - &values[0]) / period_size;
-                  rv[index] += value;
-                });
+  // Same segmented reduction as normalize_acc_values (incomplete periods are
+  // dropped, so every bin is full)
+  std::for_each(std::execution::par, rv.begin(), rv.end(),
+                [&rv, &values, period_size](float_t& value) {
+                  const size_t begin = (&value - &rv[0]) * period_size;
 
-  std::for_each(
-      std::execution::par_unseq, rv.begin(), rv.end(),
-      [period_size](float_t& value) { value /= (period_size * HR_MAX_VALUE); });
+                  value = avx::segment_sum(values.data() + begin, period_size);
+                  value /= period_size * HR_MAX_VALUE;
+                });
 
   logger.log_debug("Normalized HR values count: " + std::to_string(rv.size()));
 
   return rv;
 }
 
-size_t SubjectDataProcessor::interpolate_vector_linear(
-    std::vector<float_t>& vector, const size_t count) noexcept {
+void SubjectDataProcessor::interpolate_vector_linear(
+    SubjectSeries& vector, const size_t count) noexcept {
   size_t old_size = vector.size();
-
-  size_t new_size = old_size + count;
-  size_t padding = count;
-
-  if ((new_size & (new_size - 1)) != 0) {  // Not a power of 2
-    double exp = std::floor(std::log2(new_size));
-    new_size = (size_t)pow(2, exp + 1);
-    padding = new_size - old_size;
+  if (old_size < 2 || count == 0) {
+    return;  // Nothing to interpolate from
   }
 
-  vector.resize(new_size);
+  vector.resize(old_size + count);
 
-  for (size_t i = 0; i < padding; ++i) {
-    float_t t = (float_t)i / (padding - 1);
+  for (size_t i = 0; i < count; ++i) {
+    float_t t = count > 1 ? (float_t)i / (count - 1) : 0.0f;
     size_t index = (size_t)(t * (old_size - 1));  // Index in the smaller vector
     float_t fraction =
         t * (old_size - 1) - index;  // Fractional part for interpolation
@@ -319,8 +1367,6 @@ size_t SubjectDataProcessor::interpolate_vector_linear(
         vector[index] + fraction * (vector[index + 1] -
                                     vector[index]);  // Lerp = a + f * (b - a)
   }
-
-  return padding - count;
 }
 
 // PUBLIC METHODS //
@@ -328,85 +1374,194 @@ size_t SubjectDataProcessor::interpolate_vector_linear(
 const std::chrono::system_clock::time_point
 SubjectDataProcessor::parse_datetime(const std::string& timestamp,
                                      const std::string& format) noexcept {
+  if (format == DATETIME_FORMAT) {
+    DatetimeDecoder decoder;
+    const std::optional<int64_t> microseconds =
+        decoder.decode(timestamp.data(), timestamp.data() + timestamp.size());
+    if (microseconds != std::nullopt) {
+      return std::chrono::system_clock::time_point(
+          std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              std::chrono::microseconds(microseconds.value())));
+    }
+  }
+
+  // Generic formats. Interpreted as UTC as well, so that both paths agree
   std::tm tm{};
   std::istringstream ss(timestamp);
   ss >> std::get_time(&tm, format.c_str());
 
-  return std::chrono::system_clock::from_time_t(std::mktime(&tm));
+  const int64_t seconds =
+      days_from_civil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday) *
+          SECONDS_PER_DAY +
+      tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+
+  return std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
 }
 
-std::pair<uint8_t, long long> SubjectDataProcessor::validate_timestamps(
-    const uint8_t period_size) noexcept {
-  if (!_acc_file_stream.is_open() || !_hr_file_stream.is_open()) {
-    logger.log_error(errors::ERRORS::COULD_NOT_OPEN_FILE_HANDLE,
-                     "(" + _hr_file_path + " or " + _acc_file_path + ")");
-    return std::pair(EXIT_FAILURE, LONG_MIN);
-  }
+std::optional<std::vector<int64_t>>
+SubjectDataProcessor::parse_acc_timestamps() noexcept {
+  return parse_timestamps(_acc_file_map, _acc_file_stream, _acc_file_path);
+}
 
-  if (period_size == 0) {
-    logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
-                     "Provided value: (" + std::to_string(period_size) + ")");
-    return std::pair(RETURN_NOK, LONG_MIN);
+std::optional<std::vector<int64_t>>
+SubjectDataProcessor::parse_hr_timestamps() noexcept {
+  return parse_timestamps(_hr_file_map, _hr_file_stream, _hr_file_path);
+}
+
+std::optional<std::vector<int64_t>> SubjectDataProcessor::parse_timestamps(
+    const MappedFile& file_map, std::ifstream& file_stream,
+    const std::string& file_path) noexcept {
+  std::vector<int64_t> timestamps;
+
+  if (StreamingDecompressor::compression_of(file_path) != COMPRESSION::NONE) {
+    DatetimeDecoder decoder;
+    bool header = true;
+    std::string failed_line;
+
+    StreamingDecompressor decompressor(file_path);
+    const bool decompressed = decompressor.read_lines(
+        [&decoder, &header, &failed_line, &timestamps](
+            const char* cursor, const char* const end) {
+          if (header) {  // Skip the first line
+            cursor = skip_lines(cursor, end, 1);
+            header = false;
+          }
+
+          const char* stop = decoder.decode_lines(cursor, end, timestamps);
+          if (stop != end) {
+            failed_line.assign(stop, std::find(stop, end, '\n'));
+            return false;
+          }
+
+          return true;
+        });
+
+    if (!decompressed) {
+      logger.log_error(errors::ERRORS::COULD_NOT_DECOMPRESS_FILE,
+                       decompressor.error());
+      return std::nullopt;
+    }
+
+    if (!failed_line.empty()) {
+      logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE,
+                       "(Timestamp: " + failed_line + " in " + file_path + ")");
+      return std::nullopt;
+    }
+
+    return timestamps;
   }
 
-  _acc_file_stream.seekg(_acc_file_stream.beg);
-  _hr_file_stream.seekg(_hr_file_stream.beg);
+  if (_reader == INPUT_READER::STREAM) {
+    std::string curr_line;
+    DatetimeDecoder decoder;
 
-  std::string curr_line;
-  u_long pos;
+    file_stream.clear();
+    file_stream.seekg(file_stream.beg);
+    std::getline(file_stream, curr_line);  // Skip the first line
 
-  // Skip the first lines
-  std::getline(_acc_file_stream, curr_line);
-  std::getline(_hr_file_stream, curr_line);
+    while (std::getline(file_stream, curr_line)) {
+      if (curr_line.empty() || curr_line == "\r") {
+        continue;
+      }
 
-  std::getline(_acc_file_stream, curr_line);
-  pos = curr_line.find(DATA_DELIMITER);
-  if (pos == std::string::npos) {
-    logger.log_error(errors::ERRORS::INVALID_FILE_STRUCTURE,
-                     "ACC files must have the following structure: "
-                     "datetime" +
-                         std::to_string(DATA_DELIMITER) + "acc_x" +
-                         std::to_string(DATA_DELIMITER) + "acc_y" +
-                         std::to_string(DATA_DELIMITER) + "acc_z");
-    return std::pair(EXIT_FAILURE, LONG_MIN);
+      const std::optional<int64_t> timestamp = decoder.decode(
+          curr_line.data(), curr_line.data() + curr_line.size());
+      if (timestamp == std::nullopt) {
+        logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE,
+                         "(Timestamp: " + curr_line + ")");
+        return std::nullopt;
+      }
+
+      timestamps.push_back(timestamp.value());
+    }
+
+    return timestamps;
   }
 
-  curr_line.erase(pos + 1, curr_line.length() - 1);
+  const char* cursor = skip_lines(file_map.begin(), file_map.end(), 1);
+  const std::vector<const char*> bounds =
+      split_into_chunks(cursor, file_map.end());
+  const size_t chunks_count = bounds.size() - 1;
 
-  const std::chrono::time_point acc_timestamp =
-      parse_datetime(curr_line, DATETIME_FORMAT);
+  std::vector<std::vector<int64_t>> chunk_timestamps(chunks_count);
+  std::vector<const char*> chunk_failures(chunks_count, nullptr);
 
-  std::getline(_hr_file_stream, curr_line);
+  run_on_chunks(chunks_count, [&bounds, &chunk_timestamps,
+                               &chunk_failures](const size_t i) {
+    chunk_timestamps[i].reserve(std::count(bounds[i], bounds[i + 1], '\n') +
+                                1);
 
-  pos = curr_line.find(DATA_DELIMITER);
-  if (pos == std::string::npos) {
-    logger.log_error(errors::ERRORS::INVALID_FILE_STRUCTURE,
-                     "HR files must have the following structure: "
-                     "datetime" +
-                         std::to_string(DATA_DELIMITER) + "hr");
-    return std::pair(EXIT_FAILURE, LONG_MIN);
+    DatetimeDecoder decoder;
+    const char* stop =
+        decoder.decode_lines(bounds[i], bounds[i + 1], chunk_timestamps[i]);
+    if (stop != bounds[i + 1]) {
+      chunk_failures[i] = stop;
+    }
+  });
+
+  size_t count = 0;
+  for (size_t i = 0; i < chunks_count; ++i) {
+    if (chunk_failures[i] != nullptr) {
+      const char* line_end = std::find(chunk_failures[i], bounds[i + 1], '\n');
+      logger.log_error(errors::ERRORS::COULD_NOT_PARSE_VALUE,
+                       "(Timestamp: " +
+                           std::string(chunk_failures[i], line_end) + " in " +
+                           file_path + ")");
+      return std::nullopt;
+    }
+
+    count += chunk_timestamps[i].size();
   }
 
-  curr_line.erase(pos + 1, curr_line.length() - 1);
+  timestamps = std::move(chunk_timestamps[0]);
+  timestamps.reserve(count);
+  for (size_t i = 1; i < chunks_count; ++i) {
+    timestamps.insert(timestamps.end(), chunk_timestamps[i].begin(),
+                      chunk_timestamps[i].end());
+  }
 
-  const std::chrono::time_point hr_timestamp =
-      parse_datetime(curr_line, DATETIME_FORMAT);
+  return timestamps;
+}
 
-  std::chrono::seconds acc_seconds =
-      std::chrono::duration_cast<std::chrono::seconds>(
-          acc_timestamp.time_since_epoch());
+std::pair<uint8_t, long long> SubjectDataProcessor::validate_timestamps(
+    const uint8_t period_size) noexcept {
+  if (!_acc_file_stream.is_open() || !_hr_file_stream.is_open()) {
+    logger.log_error(errors::ERRORS::COULD_NOT_OPEN_FILE_HANDLE,
+                     "(" + _hr_file_path + " or " + _acc_file_path + ")");
+    return std::pair(EXIT_FAILURE, LONG_MIN);
+  }
 
-  logger.log_debug("Calculated ACC time since epoch: " +
-                   std::to_string(acc_seconds.count()));
+  if (period_size == 0) {
+    logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
+                     "Provided value: (" + std::to_string(period_size) + ")");
+    return std::pair(RETURN_NOK, LONG_MIN);
+  }
 
-  std::chrono::seconds hr_seconds =
-      std::chrono::duration_cast<std::chrono::seconds>(
-          hr_timestamp.time_since_epoch());
+  // Cached start timestamps do not need any text parsing
+  const std::optional<int64_t> acc_seconds =
+      _acc_cache.is_valid()
+          ? _acc_cache.header().start_epoch
+          : read_start_epoch(_acc_file_stream, _acc_file_path,
+                             "ACC files must have the following structure: "
+                             "datetime,acc_x,acc_y,acc_z");
+
+  const std::optional<int64_t> hr_seconds =
+      _hr_cache.is_valid()
+          ? _hr_cache.header().start_epoch
+          : read_start_epoch(_hr_file_stream, _hr_file_path,
+                             "HR files must have the following structure: "
+                             "datetime,hr");
+
+  if (acc_seconds == std::nullopt || hr_seconds == std::nullopt) {
+    return std::pair(EXIT_FAILURE, LONG_MIN);
+  }
 
+  logger.log_debug("Calculated ACC time since epoch: " +
+                   std::to_string(acc_seconds.value()));
   logger.log_debug("Calculated HR time since epoch: " +
-                   std::to_string(hr_seconds.count()));
+                   std::to_string(hr_seconds.value()));
 
-  long long timestamp_diff = acc_seconds.count() - hr_seconds.count();
+  long long timestamp_diff = acc_seconds.value() - hr_seconds.value();
   if (period_size == 1) {
     return std::pair(EXIT_SUCCESS, timestamp_diff);
   }
@@ -423,7 +1578,7 @@ std::pair<uint8_t, long long> SubjectDataProcessor::validate_timestamps(
   return std::pair(RETURN_OK, timestamp_diff * tmp);
 }
 
-const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
+std::optional<std::array<SubjectSeries, ACC_NO_VALUES>>
 SubjectDataProcessor::preprocess_acc_file(
     const std::uint8_t period_size, const u_long timestamp_diff) noexcept {
   logger.log_debug("Period size: " + std::to_string(period_size));
@@ -433,23 +1588,37 @@ SubjectDataProcessor::preprocess_acc_file(
     return std::nullopt;
   }
 
+  if (_use_acc_cache && !_acc_cache.is_valid()) {
+    build_acc_cache();
+  }
+
+  // Fused paths - the raw values are never materialized
+  if (_acc_cache.is_valid()) {
+    return normalize_acc_cache(period_size, timestamp_diff);
+  }
+
+  if (_reader != INPUT_READER::STREAM &&
+      _acc_compression == COMPRESSION::NONE) {
+    return parse_acc_normalized(period_size, timestamp_diff);
+  }
+
   std::optional parsed_optional = parse_acc_file(period_size, timestamp_diff);
 
   if (parsed_optional == std::nullopt) {
     return std::nullopt;
   }
 
-  std::array<std::vector<float_t>, ACC_NO_VALUES> parsed_values =
+  const std::array<std::vector<float_t>, ACC_NO_VALUES>& parsed_values =
       parsed_optional.value();
 
   logger.log_debug("Parsed values size: " +
                    std::to_string(parsed_values.size()));
 
-  std::array<std::vector<float_t>, ACC_NO_VALUES> normalized_values;
+  std::array<SubjectSeries, ACC_NO_VALUES> normalized_values;
   size_t count = 0;
   std::for_each(std::execution::seq, parsed_values.begin(), parsed_values.end(),
                 [period_size, &normalized_values, &count,
-                 this](std::vector<float_t>& curr_vals) {
+                 this](const std::vector<float_t>& curr_vals) {
                   normalized_values[count++] =
                       normalize_acc_values(period_size, curr_vals);
                 });
@@ -467,9 +1636,8 @@ SubjectDataProcessor::preprocess_acc_file(
   return normalized_values;
 }
 
-const std::optional<std::vector<float_t>>
-SubjectDataProcessor::preprocess_hr_file(const uint8_t period_size,
-                                         const u_long timestamp_diff) noexcept {
+std::optional<SubjectSeries> SubjectDataProcessor::preprocess_hr_file(
+    const uint8_t period_size, const u_long timestamp_diff) noexcept {
   if (period_size == 0) {
     logger.log_error(errors::ERRORS::INVALID_PERIOD_SIZE,
                      "(Provided value: " + std::to_string(period_size) + ")");
@@ -481,7 +1649,7 @@ SubjectDataProcessor::preprocess_hr_file(const uint8_t period_size,
     return std::nullopt;
   }
 
-  std::vector<float_t> parsed_values = parsed_optional.value();
+  const std::vector<float_t>& parsed_values = parsed_optional.value();
 
   if (parsed_values.empty()) {
     return std::nullopt;
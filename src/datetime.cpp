@@ -0,0 +1,130 @@
+#include "include/datetime.hpp"
+#include <cstring>
+
+namespace DataPreprocessing {
+
+/** Value of a decimal digit, or a value above 9 if the character is not a digit */
+static inline uint32_t digit(const char character) noexcept {
+  return (uint32_t)(uint8_t)(character - '0');
+}
+
+bool DatetimeDecoder::decode_date(const char* timestamp) noexcept {
+  const uint32_t y0 = digit(timestamp[0]), y1 = digit(timestamp[1]),
+                 y2 = digit(timestamp[2]), y3 = digit(timestamp[3]);
+  const uint32_t m0 = digit(timestamp[5]), m1 = digit(timestamp[6]);
+  const uint32_t d0 = digit(timestamp[8]), d1 = digit(timestamp[9]);
+
+  // Evaluate all of the checks, branch only once
+  const bool digits_valid = (y0 < 10) & (y1 < 10) & (y2 < 10) & (y3 < 10) &
+                            (m0 < 10) & (m1 < 10) & (d0 < 10) & (d1 < 10);
+  const bool separators_valid = (timestamp[4] == '-') & (timestamp[7] == '-');
+
+  const uint32_t year = y0 * 1000 + y1 * 100 + y2 * 10 + y3;
+  const uint32_t month = m0 * 10 + m1;
+  const uint32_t day = d0 * 10 + d1;
+
+  // Days beyond the end of the month would roll over into the next one
+  if (!(digits_valid & separators_valid & (month - 1 < 12) &
+        (day - 1 < days_in_month(year, month)))) {
+    _has_date = false;
+    return false;
+  }
+
+  std::memcpy(_date, timestamp, DATE_LENGTH);
+  _date_epoch = days_from_civil(year, month, day) * SECONDS_PER_DAY *
+                MICROSECONDS_PER_SECOND;
+  _has_date = true;
+
+  return true;
+}
+
+std::optional<int64_t> DatetimeDecoder::decode(const char* begin,
+                                               const char* const end) noexcept {
+  if (end - begin < (ptrdiff_t)DATETIME_LENGTH) {
+    return std::nullopt;
+  }
+
+  // Measurements are sorted, so the date changes at most once a day
+  if (!_has_date || std::memcmp(begin, _date, DATE_LENGTH) != 0) {
+    if (!decode_date(begin)) {
+      return std::nullopt;
+    }
+  }
+
+  const uint32_t h0 = digit(begin[11]), h1 = digit(begin[12]);
+  const uint32_t m0 = digit(begin[14]), m1 = digit(begin[15]);
+  const uint32_t s0 = digit(begin[17]), s1 = digit(begin[18]);
+
+  const bool digits_valid = (h0 < 10) & (h1 < 10) & (m0 < 10) & (m1 < 10) &
+                            (s0 < 10) & (s1 < 10);
+  const bool separators_valid = (begin[10] == ' ' || begin[10] == 'T') &
+                                (begin[13] == ':') & (begin[16] == ':');
+
+  const uint32_t hours = h0 * 10 + h1;
+  const uint32_t minutes = m0 * 10 + m1;
+  const uint32_t seconds = s0 * 10 + s1;
+
+  if (!(digits_valid & separators_valid & (hours < 24) & (minutes < 60) &
+        (seconds < 61))) {  // 60 is a leap second
+    return std::nullopt;
+  }
+
+  int64_t microseconds = 0;
+  const char* cursor = begin + DATETIME_LENGTH;
+  if (cursor < end && *cursor == '.') {
+    const size_t FRACTION_DIGITS = 6;
+    size_t digits = 0;
+
+    // Digits beyond microseconds are truncated
+    for (++cursor; cursor < end && digit(*cursor) < 10; ++cursor, ++digits) {
+      if (digits < FRACTION_DIGITS) {
+        microseconds = microseconds * 10 + digit(*cursor);
+      }
+    }
+
+    if (digits == 0) {
+      return std::nullopt;
+    }
+
+    for (; digits < FRACTION_DIGITS; ++digits) {
+      microseconds *= 10;
+    }
+  }
+
+  return _date_epoch +
+         (int64_t)(hours * 3600 + minutes * 60 + seconds) *
+             MICROSECONDS_PER_SECOND +
+         microseconds;
+}
+
+const char* DatetimeDecoder::decode_lines(
+    const char* cursor, const char* const end,
+    std::vector<int64_t>& timestamps) noexcept {
+  while (cursor < end) {
+    const void* newline = std::memchr(cursor, '\n', end - cursor);
+    const char* line_end =
+        newline == nullptr ? end : static_cast<const char*>(newline);
+    const char* next_line = line_end == end ? end : line_end + 1;
+
+    if (line_end > cursor && *(line_end - 1) == '\r') {
+      --line_end;
+    }
+
+    if (line_end == cursor) {  // Empty line
+      cursor = next_line;
+      continue;
+    }
+
+    const std::optional<int64_t> timestamp = decode(cursor, line_end);
+    if (timestamp == std::nullopt) {
+      return cursor;
+    }
+
+    timestamps.push_back(timestamp.value());
+    cursor = next_line;
+  }
+
+  return end;
+}
+
+}  // namespace DataPreprocessing
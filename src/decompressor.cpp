@@ -0,0 +1,293 @@
+#include "include/decompressor.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "include/constants.hpp"
+
+#ifdef PPR_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef PPR_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace DataPreprocessing {
+
+BlockQueue::BlockQueue(const size_t capacity) noexcept
+    : _capacity(std::max<size_t>(1, capacity)) {}
+
+bool BlockQueue::push(std::vector<char>&& block) noexcept {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_full.wait(lock,
+                   [this] { return _closed || _blocks.size() < _capacity; });
+    if (_closed) {
+      return false;
+    }
+
+    _blocks.push_back(std::move(block));
+  }
+  _not_empty.notify_one();
+
+  return true;
+}
+
+std::optional<std::vector<char>> BlockQueue::pop() noexcept {
+  std::vector<char> block;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_empty.wait(lock, [this] { return _closed || !_blocks.empty(); });
+    if (_blocks.empty()) {
+      return std::nullopt;
+    }
+
+    block = std::move(_blocks.front());
+    _blocks.pop_front();
+  }
+  _not_full.notify_one();
+
+  return block;
+}
+
+void BlockQueue::close() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed = true;
+  }
+  _not_empty.notify_all();
+  _not_full.notify_all();
+}
+
+StreamingDecompressor::StreamingDecompressor(const std::string& file_path,
+                                             const size_t block_size,
+                                             const size_t queue_depth) noexcept
+    : _file_path(file_path),
+      _compression(compression_of(file_path)),
+      _block_size(std::max<size_t>(1, block_size)),
+      _queue(queue_depth) {
+  _worker = std::thread(&StreamingDecompressor::run, this);
+}
+
+StreamingDecompressor::~StreamingDecompressor() {
+  _queue.close();  // Unblocks the worker, if the consumer has stopped early
+  if (_worker.joinable()) {
+    _worker.join();
+  }
+}
+
+COMPRESSION StreamingDecompressor::compression_of(
+    const std::string& file_path) noexcept {
+  const auto ends_with = [&file_path](const std::string& suffix) {
+    return file_path.size() >= suffix.size() &&
+           file_path.compare(file_path.size() - suffix.size(), suffix.size(),
+                             suffix) == 0;
+  };
+
+  if (ends_with(GZIP_FILE_FORMAT)) {
+    return COMPRESSION::GZIP;
+  }
+
+  if (ends_with(ZSTD_FILE_FORMAT)) {
+    return COMPRESSION::ZSTD;
+  }
+
+  return COMPRESSION::NONE;
+}
+
+bool StreamingDecompressor::is_supported(
+    const COMPRESSION compression) noexcept {
+  switch (compression) {
+    case COMPRESSION::NONE:
+      return true;
+    case COMPRESSION::GZIP:
+#ifdef PPR_HAVE_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    case COMPRESSION::ZSTD:
+#ifdef PPR_HAVE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+  }
+
+  return false;
+}
+
+void StreamingDecompressor::run() noexcept {
+  if (!is_supported(_compression)) {
+    _error = "Support of the compression has not been built in (" +
+             _file_path + ")";
+  } else if (_compression == COMPRESSION::GZIP) {
+    decompress_gzip();
+  } else if (_compression == COMPRESSION::ZSTD) {
+    decompress_zstd();
+  } else {
+    _error = "File is not compressed (" + _file_path + ")";
+  }
+
+  // The consumer reads the error only after the queue has been drained
+  _queue.close();
+}
+
+bool StreamingDecompressor::decompress_gzip() noexcept {
+#ifdef PPR_HAVE_ZLIB
+  gzFile file = gzopen(_file_path.c_str(), "rb");
+  if (file == nullptr) {
+    _error = "File could not have been opened (" + _file_path + ")";
+    return false;
+  }
+
+  gzbuffer(file, (unsigned)std::min<size_t>(_block_size, 1 << 20));
+
+  while (true) {
+    std::vector<char> block(_block_size);
+    const int read = gzread(file, block.data(), (unsigned)block.size());
+
+    // A truncated file is reported only once all of its data have been read
+    int code = Z_OK;
+    const char* message = gzerror(file, &code);
+    if (read < 0 || (read == 0 && code != Z_OK)) {
+      _error = message;  // Contains the file path already
+      gzclose(file);
+      return false;
+    }
+
+    if (read == 0) {
+      break;
+    }
+
+    block.resize((size_t)read);
+    if (!_queue.push(std::move(block))) {
+      break;  // The consumer does not need more data
+    }
+  }
+
+  gzclose(file);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool StreamingDecompressor::decompress_zstd() noexcept {
+#ifdef PPR_HAVE_ZSTD
+  std::ifstream input(_file_path, std::ios::in | std::ios::binary);
+  if (!input.is_open()) {
+    _error = "File could not have been opened (" + _file_path + ")";
+    return false;
+  }
+
+  ZSTD_DCtx* context = ZSTD_createDCtx();
+  if (context == nullptr) {
+    _error = "Decompression context could not have been created";
+    return false;
+  }
+
+  std::vector<char> input_buffer(ZSTD_DStreamInSize());
+  std::vector<char> block(_block_size);
+  ZSTD_outBuffer output = {block.data(), block.size(), 0};
+  size_t last_result = 0;
+  bool consumer_done = false;
+
+  while (!consumer_done && input) {
+    input.read(input_buffer.data(), input_buffer.size());
+    ZSTD_inBuffer chunk = {input_buffer.data(), (size_t)input.gcount(), 0};
+
+    // A full output block may leave data inside the context, call it again
+    bool flushed = true;
+    while (chunk.pos < chunk.size || !flushed) {
+      last_result = ZSTD_decompressStream(context, &output, &chunk);
+      if (ZSTD_isError(last_result)) {
+        _error = std::string(ZSTD_getErrorName(last_result)) + " (" +
+                 _file_path + ")";
+        ZSTD_freeDCtx(context);
+        return false;
+      }
+
+      flushed = output.pos < output.size;
+      if (!flushed) {
+        if (!_queue.push(std::move(block))) {
+          consumer_done = true;
+          break;
+        }
+
+        block = std::vector<char>(_block_size);
+        output = {block.data(), block.size(), 0};
+      }
+    }
+  }
+
+  // A frame still expecting data means the file is truncated
+  if (!consumer_done && last_result != 0) {
+    _error = "Compressed file is truncated (" + _file_path + ")";
+    ZSTD_freeDCtx(context);
+    return false;
+  }
+
+  if (!consumer_done && output.pos > 0) {
+    block.resize(output.pos);
+    _queue.push(std::move(block));
+  }
+
+  ZSTD_freeDCtx(context);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool StreamingDecompressor::read_lines(
+    const std::function<bool(const char*, const char*)>& consume) noexcept {
+  std::vector<char> carry;  // Beginning of a line split between blocks
+
+  while (std::optional<std::vector<char>> block = _queue.pop()) {
+    const char* begin = block.value().data();
+    const char* const end = begin + block.value().size();
+
+    // Complete the carried line
+    if (!carry.empty()) {
+      const void* newline = std::memchr(begin, '\n', end - begin);
+      if (newline == nullptr) {
+        carry.insert(carry.end(), begin, end);
+        continue;
+      }
+
+      const char* line_end = static_cast<const char*>(newline) + 1;
+      carry.insert(carry.end(), begin, line_end);
+      if (!consume(carry.data(), carry.data() + carry.size())) {
+        return true;
+      }
+
+      carry.clear();
+      begin = line_end;
+    }
+
+    const char* complete_end = end;
+    while (complete_end > begin && *(complete_end - 1) != '\n') {
+      --complete_end;
+    }
+
+    // Complete lines are consumed in place
+    if (complete_end > begin && !consume(begin, complete_end)) {
+      return true;
+    }
+
+    carry.assign(complete_end, end);
+  }
+
+  if (!_error.empty()) {
+    return false;
+  }
+
+  if (!carry.empty()) {  // Last line without a newline
+    consume(carry.data(), carry.data() + carry.size());
+  }
+
+  return true;
+}
+
+}  // namespace DataPreprocessing
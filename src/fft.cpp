@@ -0,0 +1,150 @@
+#include "include/fft.hpp"
+#include <cmath>
+#include <limits>
+#include "include/logger.hpp"
+
+namespace fft {
+
+Logging::Logger& logger = Logging::Logger::get_instance();
+
+void transform(std::vector<std::complex<double>>& values,
+               const bool inverse) noexcept {
+  const size_t count = values.size();
+
+  // Bit reversal permutation
+  for (size_t i = 1, j = 0; i < count; ++i) {
+    size_t bit = count >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+
+    if (i < j) {
+      std::swap(values[i], values[j]);
+    }
+  }
+
+  for (size_t length = 2; length <= count; length <<= 1) {
+    const double angle = 2.0 * M_PI / (double)length * (inverse ? 1.0 : -1.0);
+    const std::complex<double> root(std::cos(angle), std::sin(angle));
+
+    for (size_t i = 0; i < count; i += length) {
+      std::complex<double> twiddle(1.0, 0.0);
+      for (size_t j = 0; j < length / 2; ++j) {
+        const std::complex<double> even = values[i + j];
+        const std::complex<double> odd = values[i + j + length / 2] * twiddle;
+        values[i + j] = even + odd;
+        values[i + j + length / 2] = even - odd;
+        twiddle *= root;
+      }
+    }
+  }
+
+  if (inverse) {
+    for (std::complex<double>& value : values) {
+      value /= (double)count;
+    }
+  }
+}
+
+std::optional<std::vector<float_t>> calculate_lag_correlations(
+    const DataPreprocessing::SeriesView acc_values,
+    const DataPreprocessing::SeriesView hr_values,
+    const size_t max_lag) noexcept {
+  const size_t count = acc_values.size();
+  if (count != hr_values.size() || count < 2 || max_lag + 2 > count) {
+    logger.log_error(errors::ERRORS::INVALID_ARGUMENT,
+                     "(lag scan of " + std::to_string(count) + " and " +
+                         std::to_string(hr_values.size()) +
+                         " values with the maximal lag " +
+                         std::to_string(max_lag) + ")");
+    return std::nullopt;
+  }
+
+  // Centered globally, so that the products do not lose precision
+  double acc_avg = 0.0, hr_avg = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    acc_avg += acc_values[i];
+    hr_avg += hr_values[i];
+  }
+  acc_avg /= count;
+  hr_avg /= count;
+
+  // Zero padded, so that the circular correlation does not wrap around
+  size_t transform_size = 1;
+  while (transform_size < count + max_lag) {
+    transform_size <<= 1;
+  }
+
+  std::vector<std::complex<double>> acc_transform(transform_size);
+  std::vector<std::complex<double>> hr_transform(transform_size);
+
+  // Prefix sums of the centered values and their squares
+  std::vector<double> acc_sums(count + 1, 0.0), acc_squares(count + 1, 0.0);
+  std::vector<double> hr_sums(count + 1, 0.0), hr_squares(count + 1, 0.0);
+
+  for (size_t i = 0; i < count; ++i) {
+    const double acc = acc_values[i] - acc_avg;
+    const double hr = hr_values[i] - hr_avg;
+    acc_transform[i] = acc;
+    hr_transform[i] = hr;
+    acc_sums[i + 1] = acc_sums[i] + acc;
+    acc_squares[i + 1] = acc_squares[i] + acc * acc;
+    hr_sums[i + 1] = hr_sums[i] + hr;
+    hr_squares[i + 1] = hr_squares[i] + hr * hr;
+  }
+
+  transform(acc_transform, false);
+  transform(hr_transform, false);
+
+  // Cross-correlation: sum of x[i] * y[i + L] = IFFT(conj(X) * Y)[L]
+  for (size_t i = 0; i < transform_size; ++i) {
+    acc_transform[i] = std::conj(acc_transform[i]) * hr_transform[i];
+  }
+  transform(acc_transform, true);
+
+  std::vector<float_t> correlations(2 * max_lag + 1);
+  for (int64_t lag = -(int64_t)max_lag; lag <= (int64_t)max_lag; ++lag) {
+    // Overlap - x[begin..end) is paired with y[begin + lag..end + lag)
+    const size_t begin = lag < 0 ? (size_t)-lag : 0;
+    const size_t end = lag > 0 ? count - (size_t)lag : count;
+    const double overlap = (double)(end - begin);
+
+    const double products =
+        acc_transform[lag < 0 ? transform_size + lag : lag].real();
+    const double acc_sum = acc_sums[end] - acc_sums[begin];
+    const double hr_sum = hr_sums[end + lag] - hr_sums[begin + lag];
+
+    const double covariance = products - acc_sum * hr_sum / overlap;
+    const double acc_variance =
+        acc_squares[end] - acc_squares[begin] - acc_sum * acc_sum / overlap;
+    const double hr_variance = hr_squares[end + lag] -
+                               hr_squares[begin + lag] -
+                               hr_sum * hr_sum / overlap;
+
+    correlations[lag + max_lag] =
+        acc_variance > 0.0 && hr_variance > 0.0
+            ? (float_t)(covariance / std::sqrt(acc_variance * hr_variance))
+            : std::numeric_limits<float_t>::quiet_NaN();
+  }
+
+  return correlations;
+}
+
+int64_t best_lag(const std::vector<float_t>& correlations) noexcept {
+  const int64_t max_lag = (int64_t)correlations.size() / 2;
+
+  int64_t best = 0;
+  float_t best_correlation = -1.0f;
+  for (size_t i = 0; i < correlations.size(); ++i) {
+    // NaN never compares greater, so undefined lags are skipped
+    if (std::fabs(correlations[i]) > best_correlation) {
+      best_correlation = std::fabs(correlations[i]);
+      best = (int64_t)i - max_lag;
+    }
+  }
+
+  return best;
+}
+
+}  // namespace fft
@@ -1,16 +1,91 @@
 #include "include/gpu.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <numeric>
 #include <optional>
 #include <random>
 #include "include/avx.hpp"
 #include "include/constants.hpp"
+#include "include/subject_cache.hpp"
+#include "include/warnings.hpp"
+
+#if defined(WIN32) || defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
 namespace opencl {
 
 Logging::Logger& logger = Logging::Logger::get_instance();
 
+/** Largest work-group size of the sum reduction (power of 2) */
+constexpr size_t REDUCTION_GROUP_SIZE = 256;
+
+/**
+ * Largest number of work-groups of the first reduction stage - enough to fill
+ * the device, the work items loop over the rest of the values
+ */
+constexpr size_t REDUCTION_MAX_GROUPS = 256;
+
+/**
+ * Largest number of work-groups per individual of the population evaluation.
+ * The whole population runs in one launch, so a few groups per individual
+ * already fill the device
+ */
+constexpr size_t POPULATION_GROUPS_PER_INDIVIDUAL = 16;
+
+/** Number of moments gathered per individual (sum of x, x^2 and x * y) */
+constexpr size_t POPULATION_MOMENTS = 3;
+
+/** Buffers up to this size are pooled in power of 2 buckets */
+constexpr size_t POOL_SMALL_BUFFER_SIZE = 64 * 1024;
+
+/**
+ * Larger buffers are rounded up to 1/POOL_LARGE_BUCKET_STEPS of their power of
+ * 2, so a series-sized buffer is at most 12.5 % larger than requested
+ */
+constexpr size_t POOL_LARGE_BUCKET_STEPS = 8;
+
+/**
+ * Number of free large buffers kept by the pool. The oldest ones are freed
+ * first, so the buffers of previous subject sizes do not stay resident
+ */
+constexpr size_t POOL_MAX_FREE_LARGE_BUFFERS = 8;
+
+/** Identification of the cached program binaries */
+constexpr char PROGRAM_CACHE_MAGIC[8] = {'P', 'P', 'R', 'C',
+                                         'L', 'B', 'I', 'N'};
+
+/** Version of the program cache layout. Caches of other versions are rebuilt */
+constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+
+/**
+ * Header of the cached program binary. It is followed by the identity of the
+ * build (@code identity_size characters) and the binary (@code binary_size
+ * bytes)
+ */
+struct ProgramCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t identity_size;
+  uint64_t binary_size;
+};
+
+/** Checksum of a string, formatted as 16 hexadecimal digits */
+static std::string checksum_hex(const std::string& value) noexcept {
+  std::stringstream stream;
+  stream << std::hex << std::setw(16) << std::setfill('0')
+         << DataPreprocessing::SubjectCache::checksum(
+                value.data(), value.data() + value.size());
+  return stream.str();
+}
+
 const std::string Gpu::load_kernel_source_from_file(
     const std::string& filepath) noexcept {
   if (filepath.empty()) {
@@ -36,24 +111,267 @@ const std::string Gpu::load_kernel_source_from_file(
   return kernel_string;
 }
 
-Gpu::Gpu(cl::Device device) : device(device) {
-  std::vector<std::string> source_codes{
-      load_kernel_source_from_file(OPENCL_KERNEL_FILE_PATH)};
-  cl::Program::Sources sources(source_codes);
-  cl::Context device_context = {device};
-  cl::Program program(device_context, sources);
+PooledBuffer::PooledBuffer(BufferPool* pool, const size_t bucket,
+                           cl::Buffer buffer) noexcept
+    : _pool(pool), _bucket(bucket), _buffer(std::move(buffer)) {}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : _pool(other._pool),
+      _bucket(other._bucket),
+      _buffer(std::move(other._buffer)) {
+  other._pool = nullptr;
+}
+
+PooledBuffer::~PooledBuffer() {
+  if (_pool != nullptr) {
+    _pool->release(_bucket, std::move(_buffer));
+  }
+}
+
+void BufferPool::set_context(const cl::Context& context) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _context = context;
+  _free_buffers.clear();
+  _free_large_buffers.clear();
+}
+
+size_t BufferPool::bucket_of(const size_t size) noexcept {
+  size_t bucket = 1;
+  while (bucket < size && bucket < POOL_SMALL_BUFFER_SIZE) {
+    bucket *= 2;
+  }
+
+  if (bucket >= size) {
+    return bucket;
+  }
+
+  // Power of 2 not larger than the size, split into equal steps
+  size_t power = POOL_SMALL_BUFFER_SIZE;
+  while (power <= size / 2) {
+    power *= 2;
+  }
+
+  const size_t step = power / POOL_LARGE_BUCKET_STEPS;
+  return (size + step - 1) / step * step;
+}
+
+PooledBuffer BufferPool::acquire(const size_t size) {
+  const size_t bucket = bucket_of(size);
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (bucket <= POOL_SMALL_BUFFER_SIZE) {
+      std::vector<cl::Buffer>& buffers = _free_buffers[bucket];
+      if (!buffers.empty()) {
+        cl::Buffer buffer = std::move(buffers.back());
+        buffers.pop_back();
+        return PooledBuffer(this, bucket, std::move(buffer));
+      }
+    } else {
+      // The most recently returned buffers are the likeliest to match
+      for (auto it = _free_large_buffers.rbegin();
+           it != _free_large_buffers.rend(); ++it) {
+        if (it->first == bucket) {
+          cl::Buffer buffer = std::move(it->second);
+          _free_large_buffers.erase(std::next(it).base());
+          return PooledBuffer(this, bucket, std::move(buffer));
+        }
+      }
+    }
+  }
+
+  return PooledBuffer(this, bucket,
+                      cl::Buffer(_context, CL_MEM_READ_WRITE, bucket));
+}
+
+void BufferPool::release(const size_t bucket, cl::Buffer buffer) noexcept {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (bucket <= POOL_SMALL_BUFFER_SIZE) {
+    _free_buffers[bucket].push_back(std::move(buffer));
+    return;
+  }
+
+  _free_large_buffers.emplace_back(bucket, std::move(buffer));
+  while (_free_large_buffers.size() > POOL_MAX_FREE_LARGE_BUFFERS) {
+    _free_large_buffers.pop_front();
+  }
+}
+
+std::string Gpu::program_identity(const cl::Device& device,
+                                  const std::string& source) noexcept {
+  return "device=" + device.getInfo<CL_DEVICE_NAME>() +
+         "\ndriver=" + device.getInfo<CL_DRIVER_VERSION>() +
+         "\nversion=" + device.getInfo<CL_DEVICE_VERSION>() +
+         "\noptions=" + OPENCL_BUILD_OPTIONS +
+         "\nsource=" + checksum_hex(source);
+}
+
+std::string Gpu::program_cache_path(const cl::Device& device) noexcept {
+  const std::string device_key = device.getInfo<CL_DEVICE_NAME>() + "\n" +
+                                 device.getInfo<CL_DRIVER_VERSION>();
+  return (std::filesystem::path(OPENCL_PROGRAM_CACHE_FOLDER_PATH) /
+          ("program_" + checksum_hex(device_key) + CACHE_FILE_FORMAT))
+      .string();
+}
+
+std::optional<cl::Program> Gpu::load_cached_program(
+    const cl::Context& device_context, const cl::Device& device,
+    const std::string& identity) noexcept {
+  const std::string path = program_cache_path(device);
+
+  std::ifstream input(path, std::ios::in | std::ios::binary);
+  if (!input.is_open()) {
+    return std::nullopt;  // Not cached yet
+  }
+
+  ProgramCacheHeader header{};
+  input.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!input ||
+      std::memcmp(header.magic, PROGRAM_CACHE_MAGIC,
+                  sizeof(PROGRAM_CACHE_MAGIC)) != 0 ||
+      header.version != PROGRAM_CACHE_VERSION ||
+      header.identity_size != identity.size()) {
+    logger.log_debug("Program cache " + path + " is stale");
+    return std::nullopt;
+  }
+
+  std::string cached_identity(header.identity_size, '\0');
+  input.read(cached_identity.data(), cached_identity.size());
+  if (!input || cached_identity != identity) {
+    logger.log_debug("Program cache " + path + " is stale");
+    return std::nullopt;
+  }
+
+  cl::Program::Binaries binaries(1);
+  binaries[0].resize(header.binary_size);
+  input.read(reinterpret_cast<char*>(binaries[0].data()), header.binary_size);
+  if (!input || input.peek() != std::ifstream::traits_type::eof()) {
+    logger.log_warning(warnings::WARNINGS::PROGRAM_CACHE_NOT_USED,
+                       "(" + path + " is truncated)");
+    return std::nullopt;
+  }
 
   try {
-    program.build(device, "-cl-std=CL2.0");
+    std::vector<cl_int> binary_status;
+    cl::Program program(device_context, {device}, binaries, &binary_status);
+    program.build(device, OPENCL_BUILD_OPTIONS.c_str());
+    return program;
   } catch (cl::Error& err) {
-    std::string log = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device);
-    logger.log_error(errors::ERRORS::OPENCL_BUILD_ERROR, log);
-    return;
+    logger.log_warning(warnings::WARNINGS::PROGRAM_CACHE_NOT_USED,
+                       "(" + path + ", " + (std::string)err.what() + ", " +
+                           std::to_string(err.err()) + ")");
+  }
+
+  return std::nullopt;
+}
+
+bool Gpu::store_program_binary(const cl::Program& program,
+                               const cl::Device& device,
+                               const std::string& identity) noexcept {
+  try {
+    const cl::Program::Binaries binaries =
+        program.getInfo<CL_PROGRAM_BINARIES>();
+    if (binaries.size() != 1 || binaries[0].empty()) {
+      return false;
+    }
+
+    std::error_code err{};
+    std::filesystem::create_directories(OPENCL_PROGRAM_CACHE_FOLDER_PATH, err);
+
+    ProgramCacheHeader header{};
+    std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.identity_size = (uint32_t)identity.size();
+    header.binary_size = binaries[0].size();
+
+    const std::string path = program_cache_path(device);
+    // Processes sharing the cache folder never write into the same file,
+    // the last rename wins
+    const std::string tmp_path =
+        path + "." + std::to_string(getpid()) + ".tmp";
+
+    std::ofstream output(tmp_path, std::ios::out | std::ios::binary);
+    if (!output.is_open()) {
+      logger.log_error(errors::ERRORS::COULD_NOT_OPEN_FILE_HANDLE,
+                       "(" + tmp_path + ")");
+      return false;
+    }
+
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(identity.data(), identity.size());
+    output.write(reinterpret_cast<const char*>(binaries[0].data()),
+                 binaries[0].size());
+    output.close();
+
+    if (output.fail()) {
+      std::filesystem::remove(tmp_path, err);
+      return false;
+    }
+
+    std::filesystem::rename(tmp_path, path, err);
+    if (err) {
+      std::filesystem::remove(tmp_path, err);
+      return false;
+    }
+
+    logger.log_info("Program cache " + path + " has been written");
+    return true;
+  } catch (cl::Error& err) {
+    logger.log_error(
+        errors::ERRORS::OPENCL_BUILD_ERROR,
+        "(" + (std::string)err.what() + ", " + std::to_string(err.err()) + ")");
+  }
+
+  return false;
+}
+
+Gpu::Gpu(cl::Device device) : device(device) {
+  const std::string source =
+      load_kernel_source_from_file(OPENCL_KERNEL_FILE_PATH);
+  const std::string identity = program_identity(device, source);
+  cl::Context device_context = {device};
+
+  // Building from the source takes seconds on some drivers, the binary of the
+  // previous run is used if it was built the same way
+  std::optional<cl::Program> cached_program =
+      load_cached_program(device_context, device, identity);
+
+  cl::Program program;
+  if (cached_program != std::nullopt) {
+    logger.log_info("OpenCL program loaded from " + program_cache_path(device));
+    program = cached_program.value();
+  } else {
+    std::vector<std::string> source_codes{source};
+    cl::Program::Sources sources(source_codes);
+    program = cl::Program(device_context, sources);
+
+    try {
+      program.build(device, OPENCL_BUILD_OPTIONS.c_str());
+    } catch (cl::Error& err) {
+      std::string log = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device);
+      logger.log_error(errors::ERRORS::OPENCL_BUILD_ERROR, log);
+      return;
+    }
+
+    store_program_binary(program, device, identity);
   }
 
   this->device_context = device_context;
   this->program = program;
   this->device_queue = cl::CommandQueue(device_context, device, 0);
+  this->buffer_pool.set_context(device_context);
+}
+
+cl::Kernel& Gpu::get_kernel(const std::string& name) const {
+  const auto cached = kernels.find(name);
+  if (cached != kernels.end()) {
+    return cached->second;
+  }
+
+  cl::Kernel kernel(program, name.c_str());
+  this->dump_opencl_build_log(program);
+
+  return kernels.emplace(name, std::move(kernel)).first->second;
 }
 
 const cl::CommandQueue Gpu::get_device_queue() const noexcept {
@@ -86,37 +404,70 @@ void Gpu::copy_float_buffer(const cl::CommandQueue& device_queue,
   }
 }
 
-float_t* Gpu::sum_vector(const cl::CommandQueue& device_queue,
-                         const size_t vector_len,
-                         const cl::Buffer& vector_buffer) const noexcept {
+std::optional<float_t> Gpu::sum_vector(
+    const cl::CommandQueue& device_queue, const size_t vector_len,
+    const cl::Buffer& vector_buffer) const noexcept {
+  if (vector_len == 0) {
+    return 0.0f;
+  }
+
   try {
-    cl::Kernel kernel(program, "parallel_prefix_sum");
-    this->dump_opencl_build_log(program);
+    cl::Kernel& kernel = this->get_kernel("reduce_sum");
+
+    // The work-group tree needs a power of 2 local size
+    const size_t kernel_group_size =
+        kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+    const size_t max_group_size = std::max<size_t>(
+        1, std::min(REDUCTION_GROUP_SIZE, kernel_group_size));
+    size_t group_size = 1;
+    while (group_size * 2 <= max_group_size) {
+      group_size *= 2;
+    }
+
+    const size_t groups = std::min(REDUCTION_MAX_GROUPS,
+                                   (vector_len + group_size - 1) / group_size);
+    const int compensated =
+        avx::summation() == avx::SUMMATION::NEUMAIER ? 1 : 0;
 
-    for (size_t i = 0; i < log2(vector_len); ++i) {
-      int idx_offset = (int)std::pow(2, i + 1.0);
-      size_t nd_range = (size_t)(vector_len / idx_offset);
+    const PooledBuffer partials_buffer =
+        buffer_pool.acquire(groups * sizeof(float_t));
 
-      kernel.setArg(0, vector_buffer);
-      kernel.setArg(1, sizeof(int), &idx_offset);
+    const auto enqueue_stage = [&](const cl::Buffer& input, const int len,
+                                   const size_t stage_groups,
+                                   const cl::Buffer& output) {
+      kernel.setArg(0, input);
+      kernel.setArg(1, sizeof(int), &len);
+      kernel.setArg(2, output);
+      kernel.setArg(3, cl::Local(group_size * sizeof(float_t)));
+      kernel.setArg(4, sizeof(int), &compensated);
 
       device_queue.enqueueNDRangeKernel(kernel, cl::NullRange,
-                                        cl::NDRange(nd_range), cl::NullRange);
+                                        cl::NDRange(stage_groups * group_size),
+                                        cl::NDRange(group_size));
+    };
+
+    enqueue_stage(vector_buffer, (int)vector_len, groups,
+                  partials_buffer.get());
+
+    // A single group sums the partials, unless there is only one of them
+    const PooledBuffer result_buffer = buffer_pool.acquire(sizeof(float_t));
+    if (groups > 1) {
+      enqueue_stage(partials_buffer.get(), (int)groups, 1,
+                    result_buffer.get());
     }
 
-    float_t* result = reinterpret_cast<float*>(device_queue.enqueueMapBuffer(
-        vector_buffer,
-        CL_TRUE,  // blokovat
-        CL_MAP_READ, 0,
-        vector_len * sizeof(float_t)));  // The sum is at the last position
-
-    return result;
+    // Only the scalar is transferred back
+    float_t sum = 0.0f;
+    device_queue.enqueueReadBuffer(
+        groups > 1 ? result_buffer.get() : partials_buffer.get(), CL_TRUE, 0,
+        sizeof(float_t), &sum);
+    return sum;
   } catch (cl::Error& err) {
     logger.log_error(
         errors::ERRORS::OPENCL_BUILD_ERROR,
         "(" + (std::string)err.what() + ", " + std::to_string(err.err()) + ")");
   }
-  return nullptr;
+  return std::nullopt;
 }
 
 void Gpu::calculate_correlation_acc_values(
@@ -126,8 +477,7 @@ void Gpu::calculate_correlation_acc_values(
     const float_t acc_avg) const noexcept {
 
   try {
-    cl::Kernel kernel(program, "calculate_correlation_acc_values");
-    this->dump_opencl_build_log(program);
+    cl::Kernel& kernel = this->get_kernel("calculate_correlation_acc_values");
 
     kernel.setArg(0, nominator_buffer);
     kernel.setArg(1, acc_diff_squared_buffer);
@@ -148,8 +498,7 @@ void Gpu::perform_crossover(const cl::CommandQueue& device_queue,
                             const cl::Buffer& generation_buffer,
                             const size_t crossover_point) const noexcept {
   try {
-    cl::Kernel kernel(program, "perform_crossover");
-    this->dump_opencl_build_log(program);
+    cl::Kernel& kernel = this->get_kernel("perform_crossover");
 
     kernel.setArg(0, generation_buffer);
     kernel.setArg(1, (int)crossover_point);
@@ -171,57 +520,50 @@ float_t Gpu::compute_pearsons_correlation(
     const float_t hr_values_diff_squared_root, const size_t acc_buffer_size,
     const size_t acc_vector_len) const noexcept {
 
-  const cl::Buffer working_buffer = cl::Buffer(
-      this->device_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
-      acc_buffer_size, nullptr);
-
-  const cl::Buffer acc_diff_squared_buffer = cl::Buffer(
-      this->device_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
-      acc_buffer_size, nullptr);
-
   cl::CommandQueue queue = this->get_device_queue();
   try {
-
-    // Calculate ACC average
-    this->copy_float_buffer(queue, acc_buffer_size, acc_buffer, 0,
-                            working_buffer, 0);
-
-    float_t vec_sum = this->sum_vector(queue, acc_vector_len,
-                                       working_buffer)[acc_vector_len - 1];
+    // Reused by every evaluation of the generation
+    const PooledBuffer working_buffer = buffer_pool.acquire(acc_buffer_size);
+    const PooledBuffer acc_diff_squared_buffer =
+        buffer_pool.acquire(acc_buffer_size);
+
+    // Calculate ACC average. The reduction does not modify its input
+    const std::optional<float_t> vec_sum =
+        this->sum_vector(queue, acc_vector_len, acc_buffer);
+    if (vec_sum == std::nullopt) {
+      return 0.0;
+    }
     /* logger.log_debug("ACC VALUES VEC SUM (OPENCL): " + std::to_string(vec_sum)); */
 
-    float_t acc_avg = vec_sum / acc_vector_len;
+    float_t acc_avg = vec_sum.value() / acc_vector_len;
     /* logger.log_debug("ACC VALUES AVG (OPENCL): " + std::to_string(acc_avg)); */
 
-    // Prepare buffers
+    // Prepare buffers. Every squared difference is written by the kernel, so
+    // the buffer needs no clearing
     this->copy_float_buffer(queue, acc_buffer_size, acc_buffer, 0,
-                            working_buffer, 0);
-    this->fill_float_buffer(queue, 0.0, acc_buffer_size,
-                            acc_diff_squared_buffer);
+                            working_buffer.get(), 0);
 
     // Calculate correlation nominator and ACC squared diff
     this->calculate_correlation_acc_values(
-        queue, working_buffer, acc_diff_squared_buffer, hr_values_diffs_buffer,
-        acc_vector_len, acc_avg);
-
-    float* result = this->sum_vector(queue, acc_vector_len, working_buffer);
-    float_t nominator = result[acc_vector_len - 1];
-
-    queue.enqueueUnmapMemObject(working_buffer, result);
-
-    result = this->sum_vector(queue, acc_vector_len, acc_diff_squared_buffer);
-    float_t acc_diff_squared_sum = result[acc_vector_len - 1];
-
-    queue.enqueueUnmapMemObject(acc_diff_squared_buffer, result);
+        queue, working_buffer.get(), acc_diff_squared_buffer.get(),
+        hr_values_diffs_buffer, acc_vector_len, acc_avg);
+
+    const std::optional<float_t> nominator =
+        this->sum_vector(queue, acc_vector_len, working_buffer.get());
+    const std::optional<float_t> acc_diff_squared_sum = this->sum_vector(
+        queue, acc_vector_len, acc_diff_squared_buffer.get());
+    if (nominator == std::nullopt || acc_diff_squared_sum == std::nullopt) {
+      return 0.0;
+    }
 
     /* logger.log_debug("NOMINATOR: " + std::to_string(nominator)); */
     /* logger.log_debug("ACC VALUES DIFF SUM: " + */
     /* std::to_string(acc_diff_squared_sum)); */
 
     float_t denominator =
-        sqrtf(acc_diff_squared_sum) * hr_values_diff_squared_root;
+        sqrtf(acc_diff_squared_sum.value()) * hr_values_diff_squared_root;
 
-    return nominator / denominator;
+    return nominator.value() / denominator;
   } catch (cl::Error& err) {
     logger.log_error(
         errors::ERRORS::OPENCL_BUFFER_ALLOC_ERROR,
@@ -232,9 +574,77 @@ float_t Gpu::compute_pearsons_correlation(
   return 0.0;
 }
 
-std::pair<std::vector<float_t>, std::vector<float_t>>
+bool Gpu::evaluate_population(
+    const cl::CommandQueue& device_queue, const cl::Buffer& generation_buffer,
+    const cl::Buffer& acc_buffer, const cl::Buffer& hr_values_diffs_buffer,
+    const size_t values_count, const float_t hr_values_diffs_sum,
+    const float_t hr_values_diff_squared_root,
+    const cl::Buffer& fitness_buffer) const noexcept {
+  try {
+    cl::Kernel& evaluate_kernel = this->get_kernel("evaluate_population");
+    cl::Kernel& fitness_kernel = this->get_kernel("population_fitness");
+
+    // The work-group tree needs a power of 2 local size
+    const size_t kernel_group_size =
+        evaluate_kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+    const size_t max_group_size = std::max<size_t>(
+        1, std::min(REDUCTION_GROUP_SIZE, kernel_group_size));
+    size_t group_size = 1;
+    while (group_size * 2 <= max_group_size) {
+      group_size *= 2;
+    }
+
+    const size_t groups =
+        std::min(POPULATION_GROUPS_PER_INDIVIDUAL,
+                 (values_count + group_size - 1) / group_size);
+    const int len = (int)values_count;
+    const int groups_count = (int)groups;
+
+    // Sum of x, x^2 and x * y of every group of every individual
+    // Returned into the pool right after the launches are enqueued, the
+    // in-order queue finishes them before the buffer is used again
+    const PooledBuffer partials_buffer = buffer_pool.acquire(
+        GENERATION_SIZE * groups * POPULATION_MOMENTS * sizeof(float_t));
+
+    evaluate_kernel.setArg(0, generation_buffer);
+    evaluate_kernel.setArg(1, (int)GENERATION_INDIVIDUAL_SIZE);
+    evaluate_kernel.setArg(2, acc_buffer);
+    evaluate_kernel.setArg(3, hr_values_diffs_buffer);
+    evaluate_kernel.setArg(4, sizeof(int), &len);
+    evaluate_kernel.setArg(5, partials_buffer.get());
+    evaluate_kernel.setArg(
+        6, cl::Local(POPULATION_MOMENTS * group_size * sizeof(float_t)));
+
+    // Individuals along the first dimension, their samples along the second
+    device_queue.enqueueNDRangeKernel(
+        evaluate_kernel, cl::NullRange,
+        cl::NDRange(GENERATION_SIZE, groups * group_size),
+        cl::NDRange(1, group_size));
+
+    fitness_kernel.setArg(0, partials_buffer.get());
+    fitness_kernel.setArg(1, sizeof(int), &groups_count);
+    fitness_kernel.setArg(2, sizeof(int), &len);
+    fitness_kernel.setArg(3, hr_values_diffs_sum);
+    fitness_kernel.setArg(4, hr_values_diff_squared_root);
+    fitness_kernel.setArg(5, fitness_buffer);
+
+    device_queue.enqueueNDRangeKernel(fitness_kernel, cl::NullRange,
+                                      cl::NDRange(GENERATION_SIZE),
+                                      cl::NullRange);
+    return true;
+  } catch (cl::Error& err) {
+    logger.log_error(
+        errors::ERRORS::OPENCL_BUILD_ERROR,
+        "(" + (std::string)err.what() + ", " + std::to_string(err.err()) + ")");
+  }
+
+  return false;
+}
+
+std::pair<DataPreprocessing::SubjectSeries, std::vector<float_t>>
 Gpu::compute_correlation_formula(
-    std::vector<float_t>& acc_values, std::vector<float_t>& hr_values_diffs,
+    const DataPreprocessing::SeriesView acc_values,
+    const DataPreprocessing::SeriesView hr_values_diffs,
     const float_t hr_values_diff_squared_root) const noexcept {
 
   const cl::CommandQueue queue = this->device_queue;
@@ -248,8 +658,6 @@ Gpu::compute_correlation_formula(
   std::mt19937 gen(rd());  // Standard Mersenne Twister
 
   std::uniform_real_distribution<float_t> operand_distr(0.0f, 0.5f);
-  std::uniform_int_distribution<size_t> op_distr(1, 4);  // 1, 2, 3 or 4
-  std::uniform_int_distribution<size_t> x_distr(0, 1);   // Either 0 or 1
 
   // Initialize the first generation
   for (size_t i = 0; i < GENERATION_SIZE; i += 2) {
@@ -264,156 +672,178 @@ Gpu::compute_correlation_formula(
     generation[i * GENERATION_INDIVIDUAL_SIZE + 2] = operand_distr(gen);
   }
 
-  const cl::Buffer generation_buffer =
-      cl::Buffer{this->device_context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR,
-                 GENERATION_SIZE * GENERATION_INDIVIDUAL_SIZE * sizeof(float_t),
-                 generation.data()};
-
-  // Create necessary buffers
-  const cl::Buffer acc_buffer =
-      cl::Buffer(this->device_context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                 acc_values.size() * sizeof(float), acc_values.data());
+  // Create necessary buffers. The buffers are read only, so the host values are never written to
+  const cl::Buffer acc_buffer = cl::Buffer(
+      this->device_context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+      acc_values.size() * sizeof(float),
+      const_cast<float_t*>(acc_values.data()));
 
   const cl::Buffer hr_values_diffs_buffer = cl::Buffer(
       this->device_context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-      hr_values_diffs.size() * sizeof(float), hr_values_diffs.data());
+      hr_values_diffs.size() * sizeof(float),
+      const_cast<float_t*>(hr_values_diffs.data()));
 
   const float_t initial_correlation = this->compute_pearsons_correlation(
       acc_buffer, hr_values_diffs_buffer, hr_values_diff_squared_root,
       acc_values.size() * sizeof(float_t), acc_values.size());
 
-  const cl::Buffer best_fit_buffer = cl::Buffer(
-      this->device_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
-      GENERATION_INDIVIDUAL_SIZE * sizeof(float_t), nullptr);
+  // The differences are centered, their sum only compensates rounding
+  const float_t hr_values_diffs_sum = avx::vector_sum(hr_values_diffs);
 
-  size_t crossover_idx =
-      GENERATION_TREE_NODE_SIZE;  // Offset because the "root" node already initialized
+  const size_t generation_size =
+      GENERATION_SIZE * GENERATION_INDIVIDUAL_SIZE * sizeof(float_t);
 
   const float_t correlation_not_found = 2.0f;
   float_t best_found_correlation = correlation_not_found;
 
   const size_t generated_values_count = hr_values_diffs.size();
-  const cl::Buffer generated_values_buffer = cl::Buffer(
-      this->device_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
-      generated_values_count * sizeof(float_t), nullptr);
 
-  const cl::Buffer best_fit_values_buffer = cl::Buffer(
-      this->device_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR,
-      generated_values_count * sizeof(float_t), nullptr);
+  // Acquired inside the try block below, the pool throws if the device runs
+  // out of memory
+  std::optional<PooledBuffer> generation_buffer, best_fit_buffer,
+      best_fit_values_buffer, fitness_buffer, best_correlation_buffer,
+      crossover_idx_buffer;
+
+  // Every run draws different mutations, the counter-based generator is
+  // seeded once per run
+  const uint64_t seed = ((uint64_t)rd() << 32) | rd();
+  const cl_uint seed_lo = (cl_uint)seed;
+  const cl_uint seed_hi = (cl_uint)(seed >> 32);
+
+  // The initial generation is the only upload, the population is mutated
+  // and evaluated on the device from then on
+  cl::Kernel* mutate_kernel = nullptr;
+  cl::Kernel* select_kernel = nullptr;
+  try {
+    generation_buffer.emplace(buffer_pool.acquire(generation_size));
+    best_fit_buffer.emplace(
+        buffer_pool.acquire(GENERATION_INDIVIDUAL_SIZE * sizeof(float_t)));
+    best_fit_values_buffer.emplace(
+        buffer_pool.acquire(generated_values_count * sizeof(float_t)));
+
+    // The state of the search stays on the device as well
+    fitness_buffer.emplace(
+        buffer_pool.acquire(GENERATION_SIZE * sizeof(float_t)));
+    best_correlation_buffer.emplace(buffer_pool.acquire(sizeof(float_t)));
+    crossover_idx_buffer.emplace(buffer_pool.acquire(sizeof(cl_int)));
+
+    queue.enqueueWriteBuffer(generation_buffer->get(), CL_FALSE, 0,
+                             generation_size, generation.data());
+    this->fill_float_buffer(queue, correlation_not_found, sizeof(float_t),
+                            best_correlation_buffer->get());
+    queue.enqueueFillBuffer(crossover_idx_buffer->get(),
+                            (cl_int)GENERATION_TREE_NODE_SIZE, 0,
+                            sizeof(cl_int));
+
+    // Only the iteration changes between the launches
+    mutate_kernel = &this->get_kernel("mutate_population");
+    mutate_kernel->setArg(0, generation_buffer->get());
+    mutate_kernel->setArg(1, (int)GENERATION_INDIVIDUAL_SIZE);
+    mutate_kernel->setArg(2, crossover_idx_buffer->get());
+    mutate_kernel->setArg(3, seed_lo);
+    mutate_kernel->setArg(4, seed_hi);
+
+    select_kernel = &this->get_kernel("select_best");
+    select_kernel->setArg(0, fitness_buffer->get());
+    select_kernel->setArg(1, (int)GENERATION_SIZE);
+    select_kernel->setArg(2, initial_correlation);
+    select_kernel->setArg(3, generation_buffer->get());
+    select_kernel->setArg(4, (int)GENERATION_INDIVIDUAL_SIZE);
+    select_kernel->setArg(5, best_correlation_buffer->get());
+    select_kernel->setArg(6, best_fit_buffer->get());
+    select_kernel->setArg(7, crossover_idx_buffer->get());
+  } catch (cl::Error& err) {
+    logger.log_error(
+        errors::ERRORS::OPENCL_BUILD_ERROR,
+        "(" + (std::string)err.what() + ", " + std::to_string(err.err()) + ")");
+    return std::pair<DataPreprocessing::SubjectSeries, std::vector<float_t>>(
+        DataPreprocessing::SubjectSeries(), std::vector<float_t>());
+  }
 
   // Begin the genetic generation
   for (size_t i = 0; i < GENERATION_ITERATION_COUNT; ++i) {
-    const float_t prev_correlation = best_found_correlation;
-    for (size_t j = 0; j < GENERATION_SIZE; ++j) {
-      // Calculate the random matrix
-      for (size_t k = crossover_idx; k < GENERATION_INDIVIDUAL_SIZE;
-           k += GENERATION_TREE_NODE_SIZE) {
-        size_t idx = j * GENERATION_INDIVIDUAL_SIZE + k;
-        generation[idx] = (float_t)op_distr(gen);
-
-        // Decide whenever use X or not
-        generation[idx + 1] = x_distr(gen) == 0 ? X_FLOAT_REPRESENTATION
-                                                : (float_t)operand_distr(gen);
-
-        generation[idx + 2] = (float_t)operand_distr(gen);
+    try {
+      mutate_kernel->setArg(5, (cl_uint)i);
+      queue.enqueueNDRangeKernel(
+          *mutate_kernel, cl::NullRange,
+          cl::NDRange(GENERATION_SIZE,
+                      GENERATION_INDIVIDUAL_SIZE / GENERATION_TREE_NODE_SIZE),
+          cl::NullRange);
+
+      // Evaluate the whole generation at once
+      if (!this->evaluate_population(
+              queue, generation_buffer->get(), acc_buffer,
+              hr_values_diffs_buffer, generated_values_count,
+              hr_values_diffs_sum, hr_values_diff_squared_root,
+              fitness_buffer->get())) {
+        break;
       }
 
-      // Perform the generation
-      try {
-        this->fill_float_buffer(queue, 0.0f,
-                                generated_values_count * sizeof(float_t),
-                                generated_values_buffer);
-
-        cl::Kernel kernel(program, "generate_hr_values");
-        this->dump_opencl_build_log(program);
-
-        kernel.setArg(0, generation_buffer);
-        kernel.setArg(1, j);
-        kernel.setArg(2, (int)GENERATION_INDIVIDUAL_SIZE);
-        kernel.setArg(3, acc_buffer);
-        kernel.setArg(4, generated_values_buffer);
-
-        queue.enqueueNDRangeKernel(kernel, cl::NullRange,
-                                   cl::NDRange(generated_values_count),
-                                   cl::NullRange);
-
-        float_t new_correlation = this->compute_pearsons_correlation(
-            generated_values_buffer, hr_values_diffs_buffer,
-            hr_values_diff_squared_root,
-            generated_values_count * sizeof(float_t), generated_values_count);
-
-        if (std::fabs(initial_correlation - new_correlation) <
-            std::fabs(initial_correlation -
-                      best_found_correlation)) {  // Found a better fit
-          logger.log_info(
-              "Found correlation: " + std::to_string(new_correlation) + " in " +
-              std::to_string(i + 1) + ". iteration");
-          best_found_correlation = new_correlation;
-          this->copy_float_buffer(
-              queue, GENERATION_INDIVIDUAL_SIZE * sizeof(float_t),
-              generation_buffer,
-              (j * GENERATION_INDIVIDUAL_SIZE) * sizeof(float_t),
-              best_fit_buffer, 0);
-
-          this->copy_float_buffer(
-              queue, generated_values_count * sizeof(float_t),
-              generated_values_buffer, 0, best_fit_values_buffer, 0);
-        }
-
-        // Perform crossover
-        /* this->perform_crossover(queue, generation_buffer, crossover_idx); */
-
-      } catch (cl::Error& err) {
-        logger.log_error(errors::ERRORS::OPENCL_BUILD_ERROR,
-                         "(" + (std::string)err.what() + ", " +
-                             std::to_string(err.err()) + ")");
+      queue.enqueueNDRangeKernel(*select_kernel, cl::NullRange,
+                                 cl::NDRange(1), cl::NullRange);
+
+      // Crossover (perform_crossover) stays disabled, the population is only
+      // mutated
+
+      if (i > 0 && i % 10 == 0) {
+        // The only transfer during the search, for the progress report
+        queue.enqueueReadBuffer(best_correlation_buffer->get(), CL_TRUE, 0,
+                                sizeof(float_t), &best_found_correlation);
+        // Realistically it's i-1 th iteration
+        logger.log_info("Finished [" + std::to_string(i) + "/" +
+                        std::to_string(GENERATION_ITERATION_COUNT) +
+                        "] iterations, best correlation so far: " +
+                        std::to_string(best_found_correlation));
       }
-    }
-
-    if (best_found_correlation ==
-        prev_correlation) {  // Haven't found a better fit in this iteration
-      crossover_idx = crossover_idx - GENERATION_TREE_NODE_SIZE == 0
-                          ? crossover_idx
-                          : crossover_idx - GENERATION_TREE_NODE_SIZE;
-    } else {
-      crossover_idx = crossover_idx + GENERATION_TREE_NODE_SIZE >=
-                              GENERATION_INDIVIDUAL_SIZE - 1
-                          ? crossover_idx
-                          : crossover_idx + GENERATION_TREE_NODE_SIZE;
-    }
-
-    if (i > 0 && i % 10 == 0) {
-      logger.log_info("Finished [" + std::to_string(i) + "/" +
-                      std::to_string(GENERATION_ITERATION_COUNT) +
-                      "] iterations");  // Realistically it's i-1 th iteration
+    } catch (cl::Error& err) {
+      logger.log_error(
+          errors::ERRORS::OPENCL_BUILD_ERROR,
+          "(" + (std::string)err.what() + ", " + std::to_string(err.err()) +
+              ")");
     }
   }
 
   try {
-    // Unmap memory segments
-    std::vector<float_t> allocated =
-        std::vector<float_t>(generated_values_count, 0.0f);
+    queue.enqueueReadBuffer(best_correlation_buffer->get(), CL_TRUE, 0,
+                            sizeof(float_t), &best_found_correlation);
+
+    // The values of the candidates are never stored, only the best one is
+    // generated once more
+    if (best_found_correlation != correlation_not_found) {
+      cl::Kernel& kernel = this->get_kernel("generate_hr_values");
+      kernel.setArg(0, best_fit_buffer->get());
+      kernel.setArg(1, 0);
+      kernel.setArg(2, (int)GENERATION_INDIVIDUAL_SIZE);
+      kernel.setArg(3, acc_buffer);
+      kernel.setArg(4, best_fit_values_buffer->get());
+
+      queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                 cl::NDRange(generated_values_count),
+                                 cl::NullRange);
+    } else {
+      this->fill_float_buffer(queue, 0.0f,
+                              generated_values_count * sizeof(float_t),
+                              best_fit_values_buffer->get());
+      this->fill_float_buffer(queue, 0.0f,
+                              GENERATION_INDIVIDUAL_SIZE * sizeof(float_t),
+                              best_fit_buffer->get());
+    }
 
-    queue.enqueueReadBuffer(best_fit_values_buffer, CL_TRUE, 0,
+    // Read the results directly into their final storage
+    DataPreprocessing::SubjectSeries best_fit_values(generated_values_count);
+    queue.enqueueReadBuffer(best_fit_values_buffer->get(), CL_TRUE, 0,
                             generated_values_count * sizeof(float_t),
-                            allocated.data());
+                            best_fit_values.data());
 
-    std::vector<float_t> best_fit_values = allocated;
-
-    queue.enqueueUnmapMemObject(generated_values_buffer, allocated.data());
-
-    queue.enqueueReadBuffer(best_fit_buffer, CL_TRUE, 0,
+    std::vector<float_t> best_fit(GENERATION_INDIVIDUAL_SIZE, 0.0f);
+    queue.enqueueReadBuffer(best_fit_buffer->get(), CL_TRUE, 0,
                             GENERATION_INDIVIDUAL_SIZE * sizeof(float_t),
-                            allocated.data());
-
-    std::vector<float_t> best_fit = allocated;
-
-    queue.enqueueUnmapMemObject(best_fit_buffer, allocated.data());
+                            best_fit.data());
 
     logger.log_info("Best found correlation: " +
                     std::to_string(best_found_correlation));
-    return std::pair<std::vector<float_t>, std::vector<float_t>>(
-        best_fit_values, best_fit);
+    return std::pair<DataPreprocessing::SubjectSeries, std::vector<float_t>>(
+        std::move(best_fit_values), std::move(best_fit));
   }
 
   catch (cl::Error& err) {
@@ -422,8 +852,8 @@ Gpu::compute_correlation_formula(
         "(" + (std::string)err.what() + ", " + std::to_string(err.err()) + ")");
   }
 
-  return std::pair<std::vector<float_t>, std::vector<float_t>>(
-      std::vector<float_t>(), std::vector<float_t>());
+  return std::pair<DataPreprocessing::SubjectSeries, std::vector<float_t>>(
+      DataPreprocessing::SubjectSeries(), std::vector<float_t>());
 }
 
 void Gpu::dump_opencl_build_log(const cl::Program& program) const noexcept {
@@ -2,21 +2,127 @@
 
 #include <math.h>
 #include <optional>
+#include <string>
 #include <vector>
 #include "logger.hpp"
+#include "series.hpp"
 
 namespace avx {
 
+/** Instruction sets the kernels are provided for, from the narrowest */
+enum class SIMD_LEVEL : uint8_t { SCALAR, SSE, AVX2, AVX512 };
+
+/**
+ * Summation methods of the float reductions, from the fastest.
+ * NAIVE - one pass with several accumulators, the error grows with the number of values.
+ * PAIRWISE - blocks summed by the NAIVE kernels, combined pairwise (error grows with log2 of the number of blocks).
+ * NEUMAIER - compensated summation in every SIMD lane, accurate regardless of the number of values
+ */
+enum class SUMMATION : uint8_t { NAIVE, PAIRWISE, NEUMAIER };
+
+/**
+   * Check whether the CPU the program runs on supports the AVX2 (and BMI) instruction set extensions
+   *
+   * @return true if AVX2 kernels can be used, false otherwise (e.g. older x86 CPUs or non-x86 hosts)
+   */
+bool cpu_supports_avx2() noexcept;
+
+/**
+   * Instruction set the kernels run with. Detected once (CPUID), so a single binary uses the widest registers of every CPU
+   *
+   * @return The widest instruction set supported by both the CPU and the OS
+   */
+SIMD_LEVEL simd_level() noexcept;
+
+/**
+   * Human readable name of an instruction set (for logging)
+   *
+   * @param level Instruction set
+   *
+   * @return Name of the instruction set
+   */
+std::string simd_level_name(const SIMD_LEVEL level) noexcept;
+
+/**
+   * Select the summation method of vector_sum and dot_product (PAIRWISE by default). The OpenCL reductions follow it as well
+   *
+   * @param summation Summation method
+   */
+void set_summation(const SUMMATION summation) noexcept;
+
+/** Return the selected summation method */
+SUMMATION summation() noexcept;
+
+/**
+   * Name of a summation method (as accepted by parse_summation)
+   *
+   * @param summation Summation method
+   *
+   * @return Lowercase name of the method
+   */
+std::string summation_name(const SUMMATION summation) noexcept;
+
+/**
+   * Parse the name of a summation method
+   *
+   * @param name "naive", "pairwise" or "neumaier"
+   *
+   * @return The summation method, std::nullopt if the name is unknown
+   */
+std::optional<SUMMATION> parse_summation(const std::string& name) noexcept;
+
+/**
+   * Calculate sum over a vector of @type float_t with a given summation method
+   *
+   * @param values Vector to be summed
+   * @param summation Summation method
+   *
+   * @return Sum of all of the elements of the input vector
+   */
+float_t vector_sum(const DataPreprocessing::SeriesView values,
+                   const SUMMATION summation) noexcept;
+
 /**
-   * Calculate sum over a vector of @type float_t using AVX2
+   * Calculate sum over a vector of @type float_t using the kernel of simd_level() and the selected summation method. No padding required
    *
-   * @param values Vector to be "summed". Needs to be at least twice the length of the AVX2 register size. 
-   * IMPORTANT: The vector needs to be padded correctly for AVX2
+   * @param values Vector to be summed
    *
-   * @return Pair of number of elements processed (due to possible padding) and sum of all of the elements of the input vector or std::nullopt, if any requirements were not fulfilled.
+   * @return Sum of all of the elements of the input vector
+   */
+float_t vector_sum(const DataPreprocessing::SeriesView values) noexcept;
+
+/**
+   * Calculate the dot product of two vectors using the kernel of simd_level() and the selected summation method
+   *
+   * @param first First vector
+   * @param second Second vector. Only the common length of both vectors is used
+   *
+   * @return Sum of the element-wise products
+   */
+float_t dot_product(const DataPreprocessing::SeriesView first,
+                    const DataPreprocessing::SeriesView second) noexcept;
+
+/**
+   * Calculate sum over a vector of @type float_t using the kernel of simd_level()
+   *
+   * @param values Vector to be "summed". Any length, the tail is handled by the kernel (no padding required)
+   *
+   * @return Sum of all of the elements of the input vector or std::nullopt, if the vector was empty
    */
 std::optional<float_t> vector_sum_avx2(
-    const std::vector<float_t>& values) noexcept;
+    const DataPreprocessing::SeriesView values) noexcept;
+
+/**
+   * Sum a contiguous segment of values in a fixed order - eight interleaved lanes, reduced pairwise, then the tail.
+   * The AVX2 and the scalar variant perform the same operations, so the result only depends on the values,
+   * never on the CPU or on how the segments are scheduled between threads
+   *
+   * @param values Beginning of the segment
+   * @param count Number of values in the segment (no padding required)
+   *
+   * @return Sum of the segment
+   */
+float_t segment_sum(const float_t* values, const size_t count) noexcept;
 
 /**
    * Calculate the Pearson's correlation coefficient of the ACC and HR measured values
@@ -27,7 +133,54 @@ std::optional<float_t> vector_sum_avx2(
    * @return Pearson's Correlation coefficient between the two input measurements or std::nullopt if some of the requirements were not met
    */
 std::optional<float_t> calculate_pearsons_correlation(
-    const std::vector<float_t>& acc_values,
-    const std::vector<float_t>& hr_values_diffs,
+    const DataPreprocessing::SeriesView acc_values,
+    const DataPreprocessing::SeriesView hr_values_diffs,
     const float_t hr_diff_square_root) noexcept;
+
+/**
+   * Calculate the Pearson's correlation coefficients of several series (e.g. the X, Y and Z axes) with the same HR values.
+   * The moments of up to four series are gathered in a single pass, so the HR values are read from memory only once per four series
+   *
+   * @param acc_values Series of measured ACC values (or channels derived from them), all of the same length as @param hr_values_diffs
+   * @param hr_values_diffs Vector of HR values minus their average
+   * @param hr_diff_square_root Square root of the sum of the squared HR differences
+   *
+   * @return Correlation coefficient of every input series (in the same order) or std::nullopt if some of the requirements were not met
+   */
+std::optional<std::vector<float_t>> calculate_pearsons_correlations(
+    const std::vector<DataPreprocessing::SeriesView>& acc_values,
+    const DataPreprocessing::SeriesView hr_values_diffs,
+    const float_t hr_diff_square_root) noexcept;
+
+/**
+   * Calculate the Spearman's rank correlation coefficients of several series with the same HR values - the Pearson's correlation
+   * coefficients of their ranks (tied values get the average of their ranks), gathered by calculate_pearsons_correlations.
+   * The ranks are computed by a linear time radix sort (see DataPreprocessing::rank_values)
+   *
+   * @param acc_values Series of measured ACC values, all of the same length as @param hr_values
+   * @param hr_values Vector of HR values (not centered)
+   *
+   * @return Correlation coefficient of every input series (in the same order) or std::nullopt if some of the requirements were not met
+   */
+std::optional<std::vector<float_t>> calculate_spearmans_correlations(
+    const std::vector<DataPreprocessing::SeriesView>& acc_values,
+    const DataPreprocessing::SeriesView hr_values) noexcept;
+
+/**
+   * Calculate the Pearson's correlation coefficients of sliding windows of two series (correlation over time).
+   * The sums of a window are updated incrementally - only the values entering and leaving the window are read,
+   * and they are recomputed from scratch every few hundred windows to keep the rounding error bounded.
+   * Blocks of windows are processed in parallel, the values of a block by the kernels of simd_level()
+   *
+   * @param acc_values Vector of measured ACC values (only one axis)
+   * @param hr_values Vector of HR values of the same length
+   * @param window Number of values in a window (at least 2)
+   * @param step Number of values the window moves by
+   *
+   * @return Correlation coefficient of every window (NaN for windows with a constant series) or std::nullopt if some of the requirements were not met
+   */
+std::optional<std::vector<float_t>> calculate_rolling_correlations(
+    const DataPreprocessing::SeriesView acc_values,
+    const DataPreprocessing::SeriesView hr_values, const size_t window,
+    const size_t step) noexcept;
 }  // namespace avx
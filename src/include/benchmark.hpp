@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+namespace benchmark {
+
+/**
+   * Measure the throughput (in GB/s) of every available ACC file reader - the original stream reader, the scalar in-place reader and the AVX2 tokenizer - and of the timestamp decoder.
+   * Results are logged on the INFO level
+   *
+   * @param acc_file_path Path to the accelerometer source file used for the measurement
+   * @param hr_file_path Path to the matching heart rate source file
+   */
+void run_parse_benchmark(const std::string& acc_file_path,
+                         const std::string& hr_file_path) noexcept;
+
+/**
+   * Measure the throughput (in GB/s) and the relative error of every CPU summation method (naive, pairwise, Neumaier) against a long double reference.
+   * Deterministic pseudo-random values in the range of the normalized HR values are summed, results are logged on the INFO level
+   */
+void run_summation_benchmark() noexcept;
+}  // namespace benchmark
@@ -9,15 +9,19 @@ extern const uint8_t MAX_SUPPORTED_PERIOD_SIZE;
 extern const std::string FILE_PATH_SEPARATOR;
 extern const std::string RESOURCE_FOLDER_PATH;
 extern const std::string SOURCE_FILE_FORMAT;
+extern const std::string CACHE_FILE_FORMAT;
+extern const std::string GZIP_FILE_FORMAT;
+extern const std::string ZSTD_FILE_FORMAT;
 extern const std::string OPENCL_KERNEL_FILE_PATH;
+extern const std::string OPENCL_BUILD_OPTIONS;
+extern const std::string OPENCL_PROGRAM_CACHE_FOLDER_PATH;
 extern const uint8_t RETURN_OK;
 extern const uint8_t RETURN_NOK;
 extern const uint8_t ACC_SAMPLE_FREQ;
 extern const uint8_t HR_SAMPLE_FREQ;
 extern const uint8_t HR_MAX_VALUE;
 extern const uint8_t ACC_NO_VALUES;
-extern const uint8_t FLOATS_PER_AVX2;
-extern const uint8_t MIN_VEC_SIZE_AVX2;
+extern const size_t MAX_PARSE_THREADS;
 
 extern const float_t X_FLOAT_REPRESENTATION;
 extern const float_t ADD_FLOAT_REPRESENTATION;
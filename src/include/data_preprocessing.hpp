@@ -1,9 +1,16 @@
 #pragma once
 
+#include <array>
 #include <cmath>
+#include <functional>
 #include <optional>
 #include <vector>
+#include "datetime.hpp"
+#include "decompressor.hpp"
 #include "logger.hpp"
+#include "mapped_file.hpp"
+#include "series.hpp"
+#include "subject_cache.hpp"
 
 namespace DataPreprocessing {
 
@@ -17,17 +24,102 @@ constexpr static char DATA_DELIMITER = ',';
 /** Number of different values (axis). In our case is 3 because we have 3 axis (X,Y,Z) */
 constexpr size_t ACC_NO_VALUES = 3;
 
+/** Number of bytes the SIMD tokenizer may read from the beginning of an ACC line */
+constexpr size_t ACC_SIMD_LINE_WINDOW = 96;
+
 /** Format of the timestamps in the source files */
 const std::string DATETIME_FORMAT = "%Y-%m-%d %H:%M:%S";
 
+/** Strategy used for reading the source files */
+enum INPUT_READER {
+  MMAP = 0,         // File is memory mapped and parsed in place (default)
+  STREAM = 1,       // File is read line by line through std::ifstream
+  MMAP_SCALAR = 2,  // Same as MMAP, but never uses the SIMD tokenizer
+};
+
 /** Class used for subject data preprocessing methods */
 class SubjectDataProcessor {
  private:
+  INPUT_READER _reader;
+  size_t _parse_threads;
+  bool _use_acc_cache;
+  bool _use_hr_cache;
+
   std::string _acc_file_path;
+  COMPRESSION _acc_compression;
   std::ifstream _acc_file_stream;
+  MappedFile _acc_file_map;
+  SubjectCache _acc_cache;
 
   std::string _hr_file_path;
+  COMPRESSION _hr_compression;
   std::ifstream _hr_file_stream;
+  MappedFile _hr_file_map;
+  SubjectCache _hr_cache;
+
+  /**
+   * Read the timestamp of the first measurement in a source file
+   *
+   * @param file_stream Stream of the source file
+   * @param file_path Path to the source file (compressed files are decompressed instead of being read through the stream)
+   * @param structure Description of the expected file structure (used in the error message)
+   *
+   * @return Timestamp in seconds since epoch, std::nullopt if it could not have been read
+   */
+  std::optional<int64_t> read_start_epoch(
+      std::ifstream& file_stream, const std::string& file_path,
+      const std::string& structure) noexcept;
+
+  /**
+   * Decode the timestamps of all measurements of a source file. Memory mapped files are decoded in parallel chunks
+   *
+   * @param file_map Memory mapping of the source file
+   * @param file_stream Stream of the source file (used with the stream reader)
+   * @param file_path Path to the source file (used in the error message)
+   *
+   * @return Timestamps in microseconds since epoch, std::nullopt if any of them could not have been decoded
+   */
+  std::optional<std::vector<int64_t>> parse_timestamps(
+      const MappedFile& file_map, std::ifstream& file_stream,
+      const std::string& file_path) noexcept;
+
+  /** Parse the whole ACC source file and convert it into its binary cache. Not retried after a failure */
+  void build_acc_cache() noexcept;
+
+  /**
+   * Parse the whole memory mapped ACC file straight into the int8 columns of its binary cache, so that the raw values are
+   * never materialized as floats. Chunks are parsed in parallel, each into its own range of the columns
+   *
+   * @return Encoded X, Y and Z columns, std::nullopt if the file could not have been parsed or its values do not fit into int8
+   */
+  std::optional<std::vector<char>> encode_acc_buffer() noexcept;
+
+  /** Parse the whole HR source file and convert it into its binary cache. Not retried after a failure */
+  void build_hr_cache() noexcept;
+
+  /**
+   * Parse an integer value of a single field in place. Behaves like std::stoi - leading whitespace is skipped and anything after the integer part (e.g. ".0") is ignored
+   *
+   * @param cursor Position of the field inside the buffer. Will be moved onto the next delimiter (or @param line_end)
+   * @param line_end End of the current line
+   * @param value Parsed value
+   *
+   * @return true if the value has been parsed, false otherwise
+   */
+  static bool parse_field_value(const char*& cursor, const char* line_end,
+                                float_t& value) noexcept;
+
+  /**
+   * Move the cursor past the given number of lines
+   *
+   * @param cursor Current position inside the buffer
+   * @param end End of the buffer
+   * @param count Number of lines to be skipped
+   *
+   * @return Beginning of the first line that was not skipped
+   */
+  static const char* skip_lines(const char* cursor, const char* end,
+                                const u_long count) noexcept;
 
   /**
    * Parse values from the string. Example: "-1, 0, 1" would parse into std::vector{-1, 0, 1}
@@ -40,7 +132,105 @@ class SubjectDataProcessor {
       std::string& value_string) const noexcept;
 
   /**
-   * Parse out the whole ACC source file
+   * Parse a whole "datetime,x,y,z" ACC line using AVX2. Delimiters are found with 32 byte wide comparisons and the values are decoded without branches.
+   * Only lines with three plain integers of up to 3 digits are handled, anything else (or a non-AVX2 host) is left for the scalar parser
+   *
+   * @param line Beginning of the line. At least ACC_SIMD_LINE_WINDOW bytes have to be readable from here
+   * @param values Parsed X,Y,Z values
+   * @param next_line Beginning of the following line
+   *
+   * @return true if the line has been parsed, false if the scalar parser has to be used instead
+   */
+  static bool parse_acc_line_avx2(const char* line,
+                                  std::array<float_t, ACC_NO_VALUES>& values,
+                                  const char*& next_line) noexcept;
+
+  /**
+   * Parse all ACC lines inside a byte range of the memory mapped file. Does not log anything on failure, so that it can run on multiple threads at once
+   *
+   * @param cursor Beginning of the range. Has to point at the beginning of a line
+   * @param end End of the range. Has to point right after a newline (or at the end of the file)
+   * @param sink Callable invoked with the X,Y,Z values of every parsed line, in order
+   * @param error Description of the problem, if the range could not have been parsed
+   * @param log_progress Log a message after every million of the parsed lines
+   *
+   * @return true if the whole range has been parsed, false otherwise
+   */
+  template <typename LineSink>
+  bool parse_acc_range(const char* cursor, const char* const end,
+                       LineSink& sink, std::string& error,
+                       const bool log_progress) const noexcept;
+
+  /**
+   * Skip the header line and the lines needed for the timestamp sync in the memory mapped ACC file
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param timestamp_diff Time difference by which are the accelerometer measurements "ahead"
+   *
+   * @return Beginning of the first line to be parsed
+   */
+  const char* acc_data_begin(const uint8_t period_size,
+                             const u_long timestamp_diff) const noexcept;
+
+  /**
+   * Split a byte range of the memory mapped file into at most @code _parse_threads chunks, each beginning right after a newline
+   *
+   * @param cursor Beginning of the range
+   * @param end End of the range
+   *
+   * @return Bounds of the chunks - chunk i spans from bounds[i] to bounds[i + 1]
+   */
+  std::vector<const char*> split_into_chunks(
+      const char* cursor, const char* const end) const noexcept;
+
+  /**
+   * Count non-empty lines inside a byte range
+   *
+   * @param cursor Beginning of the range. Has to point at the beginning of a line
+   * @param end End of the range
+   *
+   * @return Number of lines parse_acc_range would parse
+   */
+  static size_t count_data_lines(const char* cursor,
+                                 const char* const end) noexcept;
+
+  /**
+   * Run a task for every chunk, each on its own thread (or on the calling thread if there is only one chunk)
+   *
+   * @param chunks_count Number of chunks
+   * @param task Task to be run, gets the index of the chunk
+   */
+  void run_on_chunks(
+      const size_t chunks_count,
+      const std::function<void(const size_t)>& task) const noexcept;
+
+  /**
+   * Parse and normalize the memory mapped ACC file in one go. Every period is accumulated while parsing, so the raw values are never materialized
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param timestamp_diff Time difference by which are the accelerometer measurements "ahead"
+   *
+   * @return An array of X,Y,Z respective vectors of normalized values (same as normalize_acc_values)
+   */
+  std::optional<std::array<SubjectSeries, ACC_NO_VALUES>>
+  parse_acc_normalized(const uint8_t period_size = 1,
+                       const u_long timestamp_diff = 0) noexcept;
+
+  /**
+   * Normalize the ACC values directly from the binary cache columns
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param timestamp_diff Time difference by which are the accelerometer measurements "ahead"
+   *
+   * @return An array of X,Y,Z respective vectors of normalized values (same as normalize_acc_values)
+   */
+  std::optional<std::array<SubjectSeries, ACC_NO_VALUES>>
+  normalize_acc_cache(const uint8_t period_size = 1,
+                      const u_long timestamp_diff = 0) const noexcept;
+
+  /**
+   * Parse out the whole ACC source file directly from its memory mapping, without any per-line allocations.
+   * If more parse threads were requested, the file is split into newline aligned chunks, which are parsed in parallel and concatenated in order
    *
    * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
    * @param timestamp_diff Time difference by which are the accelerometer measurements "ahead"
@@ -48,18 +238,78 @@ class SubjectDataProcessor {
    * @return An array of X,Y,Z vectors representing the parsed values
    */
   const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
-  parse_acc_file(const uint8_t period_size = 1,
-                 const u_long timestamp_diff = 0) noexcept;
+  parse_acc_buffer(const uint8_t period_size = 1,
+                   const u_long timestamp_diff = 0) noexcept;
+
+  /**
+   * Parse out the whole ACC source file line by line using the file stream (fallback for @code parse_acc_buffer)
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param timestamp_diff Time difference by which are the accelerometer measurements "ahead"
+   *
+   * @return An array of X,Y,Z vectors representing the parsed values
+   */
+  const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
+  parse_acc_stream(const uint8_t period_size = 1,
+                   const u_long timestamp_diff = 0) noexcept;
+
+  /**
+   * Parse out the whole ACC source file while it is being decompressed (.gz or .zst) on another thread
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param timestamp_diff Time difference by which are the accelerometer measurements "ahead"
+   *
+   * @return An array of X,Y,Z vectors representing the parsed values
+   */
+  const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
+  parse_acc_compressed(const uint8_t period_size = 1,
+                       const u_long timestamp_diff = 0) noexcept;
 
   /**
-   * Parse out the whole HR source file
+   * Parse HR lines inside a byte range
+   *
+   * @param cursor Beginning of the range. Has to point at the beginning of a line
+   * @param end End of the range
+   * @param values Vector the parsed values are appended to
+   * @param error Description of the error, if any
+   *
+   * @return true if all of the lines were parsed
+   */
+  static bool parse_hr_range(const char* cursor, const char* const end,
+                             std::vector<float_t>& values,
+                             std::string& error) noexcept;
+
+  /**
+   * Parse out the whole HR source file directly from its memory mapping, without any per-line allocations
    *
    * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
    * @param timestamp_diff Time difference by which are the heart rate monitor measurements "ahead"
    *
    * @return A vector of parsed HR values
    */
-  const std::optional<std::vector<float_t>> parse_hr_file(
+  const std::optional<std::vector<float_t>> parse_hr_buffer(
+      const uint8_t period_size = 1, const u_long timestamp_diff = 0) noexcept;
+
+  /**
+   * Parse out the whole HR source file line by line using the file stream (fallback for @code parse_hr_buffer)
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param timestamp_diff Time difference by which are the heart rate monitor measurements "ahead"
+   *
+   * @return A vector of parsed HR values
+   */
+  const std::optional<std::vector<float_t>> parse_hr_stream(
+      const uint8_t period_size = 1, const u_long timestamp_diff = 0) noexcept;
+
+  /**
+   * Parse out the whole HR source file while it is being decompressed (.gz or .zst) on another thread
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param timestamp_diff Time difference by which are the heart rate monitor measurements "ahead"
+   *
+   * @return A vector of parsed HR values
+   */
+  const std::optional<std::vector<float_t>> parse_hr_compressed(
       const uint8_t period_size = 1, const u_long timestamp_diff = 0) noexcept;
 
   /**
@@ -70,9 +320,8 @@ class SubjectDataProcessor {
    *
    * @return Vector of normalized values -> moving averages mapped onto (0;1) interval
    */
-  std::vector<float_t> normalize_acc_values(
-      const uint8_t period_size,
-      const std::vector<float_t>& values) const noexcept;
+  SubjectSeries normalize_acc_values(const uint8_t period_size,
+                                     const SeriesView values) const noexcept;
 
   /**
    * Normalize values from the HR monitor
@@ -82,24 +331,66 @@ class SubjectDataProcessor {
    *
    * @return Vector of normalized values -> moving averages mapped onto (0;1) interval
    */
-  std::vector<float_t> normalize_hr_values(
-      const uint8_t period_size,
-      const std::vector<float_t>& values) const noexcept;
+  SubjectSeries normalize_hr_values(const uint8_t period_size,
+                                    const SeriesView values) const noexcept;
 
  public:
   /**
    * Class Constructor
    *
-   * @param acc_file_path Path to the accelerometer source file 
-   * @param hr_file_path Path to the heart rate source file 
+   * @param acc_file_path Path to the accelerometer source file. Files compressed with gzip (.gz) or zstd (.zst) are decompressed on the fly
+   * @param hr_file_path Path to the heart rate source file (may be compressed as well)
+   * @param reader Strategy used for reading the source files. Falls back to INPUT_READER::STREAM if a file cannot be memory mapped
+   * @param parse_threads Number of threads a single ACC file is parsed with (only for the memory mapped readers)
+   * @param use_cache Load the values from the binary caches next to the source files if they are up to date, and write them if they are not
    */
   SubjectDataProcessor(const std::string& acc_file_path,
-                       const std::string& hr_file_path);
+                       const std::string& hr_file_path,
+                       const INPUT_READER reader = INPUT_READER::MMAP,
+                       const size_t parse_threads = 1,
+                       const bool use_cache = true);
 
   virtual ~SubjectDataProcessor();
 
   /**
-   * Parse string timestamp into a datetime value 
+   * Parse out the whole ACC source file. Uses the binary cache instead, if it is enabled and up to date
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param timestamp_diff Time difference by which are the accelerometer measurements "ahead"
+   *
+   * @return An array of X,Y,Z vectors representing the parsed values
+   */
+  const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
+  parse_acc_file(const uint8_t period_size = 1,
+                 const u_long timestamp_diff = 0) noexcept;
+
+  /**
+   * Parse out the whole HR source file. Uses the binary cache instead, if it is enabled and up to date
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param timestamp_diff Time difference by which are the heart rate monitor measurements "ahead"
+   *
+   * @return A vector of parsed HR values
+   */
+  const std::optional<std::vector<float_t>> parse_hr_file(
+      const uint8_t period_size = 1, const u_long timestamp_diff = 0) noexcept;
+
+  /**
+   * Decode the timestamp of every measurement in the ACC source file
+   *
+   * @return Timestamps in microseconds since epoch (UTC), one per parsed line
+   */
+  std::optional<std::vector<int64_t>> parse_acc_timestamps() noexcept;
+
+  /**
+   * Decode the timestamp of every measurement in the HR source file
+   *
+   * @return Timestamps in microseconds since epoch (UTC), one per parsed line
+   */
+  std::optional<std::vector<int64_t>> parse_hr_timestamps() noexcept;
+
+  /**
+   * Parse string timestamp into a datetime value (UTC). Timestamps in the DATETIME_FORMAT are decoded arithmetically, other formats go through std::get_time
    *
    * @param timestamp Timestamp to be parsed
    * @param format Datetime format to be used in the parsing
@@ -120,16 +411,15 @@ class SubjectDataProcessor {
       const uint8_t period_size = 1) noexcept;
 
   /**
-   * Preprocess the ACC source file
+   * Preprocess the ACC source file. Unless the stream reader is used, the values are normalized while being parsed (or read from the cache)
    *
    * @param period_size Size of the period over which the values should be averaged (e.g. 1=1s, 10=10s, ...). Default is 1s
    * @param timestamp_diff Signalizes that the accelerometer is out of sync with the heart rate monitor. If other than zero, the number of measurements in this time interval will be skipped
    *
    * @return An array of X,Y,Z respective vectors of moving average values for each axis
    */
-  const std::optional<std::array<std::vector<float_t>, ACC_NO_VALUES>>
-  preprocess_acc_file(const uint8_t period_size = 1,
-                      const u_long timestamp_diff = 0) noexcept;
+  std::optional<std::array<SubjectSeries, ACC_NO_VALUES>> preprocess_acc_file(
+      const uint8_t period_size = 1, const u_long timestamp_diff = 0) noexcept;
 
   /**
    * Preprocess the HR source file
@@ -139,18 +429,16 @@ class SubjectDataProcessor {
    *
    * @return A vector of heart rates that are already preprocessed
    */
-  const std::optional<std::vector<float_t>> preprocess_hr_file(
+  std::optional<SubjectSeries> preprocess_hr_file(
       const uint8_t period_size = 1, const u_long timestamp_diff = 0) noexcept;
 
   /**
-   * Perform a linear interpolation on a vector and optional padding, if the new length is not padded for AVX2
+   * Perform a linear interpolation on a vector. Exactly @param count values are appended, no padding is added
    *
-   * @param vector Vector to be appended the new interpolated values
+   * @param vector Vector to be appended the new interpolated values (at least two values)
    * @param count The number of newly interpolated values
-   *
-   * @return the number of elements that were added due to AVX2 padding
    */
-  size_t interpolate_vector_linear(std::vector<float_t>& vector,
+  void interpolate_vector_linear(SubjectSeries& vector,
                                    const size_t count) noexcept;
 };
 }  // namespace DataPreprocessing
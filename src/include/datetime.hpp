@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace DataPreprocessing {
+
+/** Length of the "YYYY-MM-DD" part of a timestamp */
+constexpr size_t DATE_LENGTH = 10;
+
+/** Length of the "YYYY-MM-DD HH:MM:SS" part of a timestamp (without the fractional seconds) */
+constexpr size_t DATETIME_LENGTH = 19;
+
+/** Number of microseconds in one second */
+constexpr int64_t MICROSECONDS_PER_SECOND = 1000000;
+
+/** Number of seconds in one day */
+constexpr int64_t SECONDS_PER_DAY = 86400;
+
+/**
+ * Number of days between 1970-01-01 and a date of the proleptic Gregorian calendar.
+ * Pure arithmetic - no locale, no timezone and no table lookups
+ *
+ * @param year Year of the date
+ * @param month Month of the date (1-12)
+ * @param day Day of the month (1-31)
+ *
+ * @return Number of days since epoch (negative for dates before 1970)
+ */
+constexpr int64_t days_from_civil(int64_t year, const uint32_t month,
+                                  const uint32_t day) noexcept {
+  year -= month <= 2;  // Years begin in March, so that leap days are last
+
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const uint32_t year_of_era = (uint32_t)(year - era * 400);
+  const uint32_t day_of_year =
+      (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 -
+                              year_of_era / 100 + day_of_year;
+
+  return era * 146097 + (int64_t)day_of_era - 719468;
+}
+
+/**
+ * Number of days in a month of the proleptic Gregorian calendar
+ *
+ * @param year Year of the month (decides February of the leap years)
+ * @param month Month (1-12)
+ *
+ * @return Number of days in the month
+ */
+constexpr uint32_t days_in_month(const uint32_t year,
+                                 const uint32_t month) noexcept {
+  if (month == 2) {
+    const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return leap ? 29 : 28;
+  }
+
+  // 31 days in the odd months up to July, in the even ones from August
+  return 30 + ((month + month / 8) & 1);
+}
+
+/**
+ * Decoder of timestamps in the DATETIME_FORMAT ("YYYY-MM-DD HH:MM:SS"), optionally followed by fractional seconds (".ffffff").
+ * Timestamps are interpreted as UTC. The decoded date is cached, so consecutive timestamps of the same day only decode their time of day.
+ * An instance is not thread-safe - use one per thread
+ */
+class DatetimeDecoder {
+ private:
+  char _date[DATE_LENGTH] = {};
+  int64_t _date_epoch = 0;  // Midnight of the cached date in microseconds
+  bool _has_date = false;
+
+  /**
+   * Decode the date part of a timestamp and cache it
+   *
+   * @param timestamp Beginning of the timestamp, at least DATETIME_LENGTH characters long
+   *
+   * @return true if the date is valid
+   */
+  bool decode_date(const char* timestamp) noexcept;
+
+ public:
+  /**
+   * Decode one timestamp. Characters following the timestamp (e.g. the delimiter) are ignored
+   *
+   * @param begin Beginning of the timestamp
+   * @param end End of the readable range
+   *
+   * @return Microseconds since epoch, std::nullopt if the timestamp is not in the expected format
+   */
+  std::optional<int64_t> decode(const char* begin,
+                                const char* const end) noexcept;
+
+  /**
+   * Decode the timestamps at the beginning of every line of a byte range. Empty lines are skipped
+   *
+   * @param cursor Beginning of the range. Has to point at the beginning of a line
+   * @param end End of the range
+   * @param timestamps Vector the decoded timestamps (microseconds since epoch) are appended to
+   *
+   * @return Pointer to the first line that could not have been decoded, @param end if all of them were decoded
+   */
+  const char* decode_lines(const char* cursor, const char* const end,
+                           std::vector<int64_t>& timestamps) noexcept;
+};
+
+}  // namespace DataPreprocessing
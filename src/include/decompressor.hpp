@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace DataPreprocessing {
+
+/** Size of a single block of decompressed data in bytes */
+constexpr size_t DECOMPRESSION_BLOCK_SIZE = 1 << 20;
+
+/** Maximum number of decompressed blocks waiting for the parser */
+constexpr size_t DECOMPRESSION_QUEUE_DEPTH = 8;
+
+/** Compression of a source file, based on its extension */
+enum COMPRESSION {
+  NONE = 0,
+  GZIP = 1,  // .gz
+  ZSTD = 2,  // .zst
+};
+
+/**
+ * Bounded FIFO queue of data blocks passed from a single producer thread to a single consumer thread
+ */
+class BlockQueue {
+ private:
+  std::deque<std::vector<char>> _blocks;
+  const size_t _capacity;
+  bool _closed = false;
+  std::mutex _mutex;
+  std::condition_variable _not_empty;
+  std::condition_variable _not_full;
+
+ public:
+  /**
+   * Class Constructor
+   *
+   * @param capacity Maximum number of blocks in the queue
+   */
+  explicit BlockQueue(const size_t capacity) noexcept;
+
+  /**
+   * Append a block. Blocks while the queue is full
+   *
+   * @param block Block to be appended
+   *
+   * @return false if the queue has been closed, true otherwise
+   */
+  bool push(std::vector<char>&& block) noexcept;
+
+  /**
+   * Take the oldest block. Blocks while the queue is empty and not closed
+   *
+   * @return The block, std::nullopt if the queue has been closed and all of the blocks have been taken
+   */
+  std::optional<std::vector<char>> pop() noexcept;
+
+  /** Close the queue. Blocked producer and consumer are woken up */
+  void close() noexcept;
+};
+
+/**
+ * Decompression of a compressed source file on a dedicated thread. The decompressed data are never written to disk -
+ * they are passed in blocks to the consumer through a bounded queue, so that the decompression and the parsing overlap
+ */
+class StreamingDecompressor {
+ private:
+  const std::string _file_path;
+  const COMPRESSION _compression;
+  const size_t _block_size;
+  BlockQueue _queue;
+  std::string _error;  // Written by the worker before the queue is closed
+  std::thread _worker;
+
+  /** Body of the decompression thread */
+  void run() noexcept;
+
+  /** Decompress a gzip file into the queue. @return false on error */
+  bool decompress_gzip() noexcept;
+
+  /** Decompress a zstd file into the queue. @return false on error */
+  bool decompress_zstd() noexcept;
+
+ public:
+  /**
+   * Class Constructor. Starts the decompression thread
+   *
+   * @param file_path Path to the compressed file
+   * @param block_size Size of the decompressed blocks in bytes
+   * @param queue_depth Maximum number of blocks waiting for the consumer
+   */
+  explicit StreamingDecompressor(
+      const std::string& file_path,
+      const size_t block_size = DECOMPRESSION_BLOCK_SIZE,
+      const size_t queue_depth = DECOMPRESSION_QUEUE_DEPTH) noexcept;
+
+  StreamingDecompressor(StreamingDecompressor const&) = delete;
+  StreamingDecompressor& operator=(StreamingDecompressor const&) = delete;
+
+  /** Class Destructor. Stops the decompression thread, even if not all of the data have been read */
+  ~StreamingDecompressor();
+
+  /**
+   * Get the compression of a file based on its extension
+   *
+   * @param file_path Path to the file
+   *
+   * @return Compression of the file
+   */
+  static COMPRESSION compression_of(const std::string& file_path) noexcept;
+
+  /**
+   * Check whether the program has been built with support of a compression
+   *
+   * @param compression Compression to be checked
+   *
+   * @return true if files with the @param compression can be read
+   */
+  static bool is_supported(const COMPRESSION compression) noexcept;
+
+  /**
+   * Pass the decompressed data to the consumer as byte ranges of complete lines. Lines split between two blocks are joined
+   *
+   * @param consume Consumer of the ranges. Every range ends right after a newline (or at the end of the data). Returning false stops the reading
+   *
+   * @return false if the file could not have been decompressed, true otherwise (also if the consumer has stopped the reading)
+   */
+  bool read_lines(
+      const std::function<bool(const char*, const char*)>& consume) noexcept;
+
+  /** @return Description of the decompression error, empty if there was none. Valid after @code read_lines() */
+  const std::string& error() const noexcept { return _error; }
+};
+
+}  // namespace DataPreprocessing
@@ -21,6 +21,7 @@ enum ERRORS {
   OPENCL_BUILD_ERROR = 12,
   OPENCL_BUFFER_ALLOC_ERROR = 13,
   OPENCL_NO_DEVICE_FOUND = 14,
+  COULD_NOT_DECOMPRESS_FILE = 15,
 };
 
 /** Map of all available errors and their respective messages */
@@ -42,6 +43,7 @@ const std::unordered_map<size_t, std::string> ERRORS_MAP = {
     {OPENCL_BUFFER_ALLOC_ERROR, "OpenCL could not allocate a buffer"},
     {OPENCL_NO_DEVICE_FOUND,
      "No OpenCL computing device found. Cannot proceed further."},
+    {COULD_NOT_DECOMPRESS_FILE, "Compressed file could not have been read"},
 
 };
 }  // namespace errors
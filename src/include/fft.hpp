@@ -0,0 +1,45 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "series.hpp"
+
+namespace fft {
+
+/**
+   * In-place iterative radix-2 fast Fourier transform
+   *
+   * @param values Values to be transformed. Their count has to be a power of 2
+   * @param inverse true for the inverse transform (the result is scaled by 1/N)
+   */
+void transform(std::vector<std::complex<double>>& values,
+               const bool inverse) noexcept;
+
+/**
+   * Calculate the Pearson's correlation coefficient of two series for every lag in a range, using the FFT cross-correlation (O(n log n) instead of O(n * lags)).
+   * At lag L, the value x[i] is paired with y[i + L] - a positive lag means that @param hr_values respond later than @param acc_values.
+   * Only the overlapping parts of the series are correlated, their averages and variances are taken from prefix sums
+   *
+   * @param acc_values Vector of measured ACC values (only one axis)
+   * @param hr_values Vector of HR values of the same length
+   * @param max_lag Largest lag (in values) in both directions. Has to be smaller than the length of the series - 1
+   *
+   * @return Correlation coefficients of the lags -max_lag..max_lag (index = lag + max_lag, NaN if the overlap is constant) or std::nullopt if some of the requirements were not met
+   */
+std::optional<std::vector<float_t>> calculate_lag_correlations(
+    const DataPreprocessing::SeriesView acc_values,
+    const DataPreprocessing::SeriesView hr_values,
+    const size_t max_lag) noexcept;
+
+/**
+   * Find the lag with the strongest correlation (the largest absolute value)
+   *
+   * @param correlations Correlations of the lags -max_lag..max_lag, as returned by calculate_lag_correlations
+   *
+   * @return The best lag (negative if HR values precede the ACC values)
+   */
+int64_t best_lag(const std::vector<float_t>& correlations) noexcept;
+}  // namespace fft
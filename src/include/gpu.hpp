@@ -12,13 +12,98 @@
 #endif
 
 #include <CL/opencl.hpp>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include "logger.hpp"
 #include "math.h"
+#include "series.hpp"
 
 namespace opencl {
 
+class BufferPool;
+
+/**
+ * Device buffer borrowed from a BufferPool, returned into it when destroyed.
+ * The buffer may be larger than requested
+ */
+class PooledBuffer {
+ private:
+  BufferPool* _pool = nullptr;
+  size_t _bucket = 0;
+  cl::Buffer _buffer;
+
+ public:
+  PooledBuffer(BufferPool* pool, const size_t bucket,
+               cl::Buffer buffer) noexcept;
+
+  PooledBuffer(PooledBuffer const&) = delete;
+  PooledBuffer& operator=(PooledBuffer const&) = delete;
+
+  PooledBuffer(PooledBuffer&& other) noexcept;
+
+  ~PooledBuffer();
+
+  const cl::Buffer& get() const noexcept { return _buffer; }
+};
+
+/**
+ * Pool of read-write device buffers, bucketed by their size. Small buffers are rounded up to a power of 2, large ones to
+ * an eighth of their power of 2. Buffers of the same bucket are reused across calls instead of being allocated every time,
+ * only a few of the large ones are kept free. Thread-safe
+ */
+class BufferPool {
+ private:
+  cl::Context _context;
+  std::map<size_t, std::vector<cl::Buffer>> _free_buffers;
+  std::deque<std::pair<size_t, cl::Buffer>> _free_large_buffers;
+  std::mutex _mutex;
+
+  /**
+   * Size of the bucket the requested size falls into
+   *
+   * @param size Requested size in bytes
+   *
+   * @return Allocated size of the buffers of the bucket
+   */
+  static size_t bucket_of(const size_t size) noexcept;
+
+ public:
+  BufferPool() noexcept = default;
+
+  BufferPool(BufferPool const&) = delete;
+  BufferPool& operator=(BufferPool const&) = delete;
+
+  /**
+   * Set the context the buffers are allocated in. Drops the free buffers of the previous context
+   *
+   * @param context OpenCL context
+   */
+  void set_context(const cl::Context& context);
+
+  /**
+   * Borrow a buffer of at least @param size bytes. Allocates a new one if there is no free buffer in the bucket.
+   * Throws cl::Error if the buffer could not have been allocated
+   *
+   * @param size Requested size in bytes
+   *
+   * @return Borrowed buffer
+   */
+  PooledBuffer acquire(const size_t size);
+
+  /**
+   * Return a borrowed buffer into its bucket (called by PooledBuffer)
+   *
+   * @param bucket Size of the buffer
+   * @param buffer Returned buffer
+   */
+  void release(const size_t bucket, cl::Buffer buffer) noexcept;
+};
+
 /**
    * Class representing a GPU OpenCL device
    */
@@ -33,6 +118,22 @@ class Gpu {
   /** OpenCL queue for this device */
   cl::CommandQueue device_queue;
 
+  /** Kernels created from the program, by their name. Created once, their arguments stay bound between the calls */
+  mutable std::unordered_map<std::string, cl::Kernel> kernels;
+
+  /** Device buffers of the temporary results, reused across the calls */
+  mutable BufferPool buffer_pool;
+
+  /**
+   * Return the kernel of the given name, create it (and dump the build log) on the first call.
+   * Throws cl::Error if the kernel could not have been created
+   *
+   * @param name Name of the kernel function
+   *
+   * @return Cached kernel. Not thread-safe - the device is used by one thread at a time
+   */
+  cl::Kernel& get_kernel(const std::string& name) const;
+
   /**
    * Load source code (kernel) for the OpenCL device from a .cl file
    *
@@ -43,6 +144,54 @@ class Gpu {
   static const std::string load_kernel_source_from_file(
       const std::string& filepath) noexcept;
 
+  /**
+   * Identity of a program build - the device, its driver, the build options and a checksum of the source code.
+   * A cached binary is only used if its identity is the same
+   *
+   * @param device OpenCL device the program is built for
+   * @param source Source code of the program
+   *
+   * @return Identity of the build
+   */
+  static std::string program_identity(const cl::Device& device,
+                                      const std::string& source) noexcept;
+
+  /**
+   * Path to the cached program binary of a device inside OPENCL_PROGRAM_CACHE_FOLDER_PATH (named by a checksum of the device name and driver version).
+   * There is one binary per device, a stale one is overwritten by the next build
+   *
+   * @param device OpenCL device the program is built for
+   *
+   * @return Path to the cache file
+   */
+  static std::string program_cache_path(const cl::Device& device) noexcept;
+
+  /**
+   * Load a program from its cached binary and build it
+   *
+   * @param device_context Context of the device
+   * @param device OpenCL device the program is built for
+   * @param identity Identity of the build
+   *
+   * @return Built program, std::nullopt if there is no cached binary, its identity differs or the binary was rejected by the driver
+   */
+  static std::optional<cl::Program> load_cached_program(
+      const cl::Context& device_context, const cl::Device& device,
+      const std::string& identity) noexcept;
+
+  /**
+   * Store the binary of a built program into the cache. The file is written under a temporary name and renamed afterwards
+   *
+   * @param program Program built for a single device
+   * @param device The device
+   * @param identity Identity of the build
+   *
+   * @return true if the binary has been written
+   */
+  static bool store_program_binary(const cl::Program& program,
+                                   const cl::Device& device,
+                                   const std::string& identity) noexcept;
+
   /**
    * Calculate the ACC values sum and differences squared (the parts of the Pearson's correlation formula)
    *
@@ -97,17 +246,18 @@ class Gpu {
                          const size_t to_offset) const noexcept;
 
   /**
-   * Parallel sum of a vector represented inside the OpenCL buffer
+   * Parallel sum of a vector represented inside the OpenCL buffer. Two-stage reduction - the work-groups reduce their part of the vector
+   * in local memory (sub-groups if supported), a single group then reduces their partial sums. Compensated if avx::summation() is NEUMAIER
    *
    * @param device_queue OpenCL queue
    * @param vector_len Count of the elements inside the vector
-   * @param vector_buffer Buffer representing the vector
+   * @param vector_buffer Buffer representing the vector (not modified)
    *
-   * @return Pointer to the parallel sums inside the buffer. The LAST element will represent the whole sum
+   * @return Sum of the vector (only the scalar is read back), std::nullopt if the OpenCL calls failed
    */
-  float_t* sum_vector(const cl::CommandQueue& device_queue,
-                      const size_t vector_len,
-                      const cl::Buffer& vector_buffer) const noexcept;
+  std::optional<float_t> sum_vector(
+      const cl::CommandQueue& device_queue, const size_t vector_len,
+      const cl::Buffer& vector_buffer) const noexcept;
 
   /**
    * Perform a generation crossover between every two individuals of the generation
@@ -134,19 +284,43 @@ class Gpu {
       const float_t hr_values_diff_squared_root, const size_t buffer_size,
       const size_t vector_len) const noexcept;
 
+  /**
+   * Compute the fitness of every individual of a generation - the Pearson's correlation coefficient of its generated values and the HR values.
+   * One 2D launch over (individual, samples) evaluates the formulas and gathers the moments of the values per work-group,
+   * a second launch reduces them into the correlations. The generated values are never stored. The launches are only enqueued
+   *
+   * @param device_queue OpenCL queue
+   * @param generation_buffer Buffer with the whole generation (GENERATION_SIZE individuals of GENERATION_INDIVIDUAL_SIZE nodes)
+   * @param acc_buffer Buffer of the initial ACC values
+   * @param hr_values_diffs_buffer Buffer with the HR values differences (of each value and their global average)
+   * @param values_count Number of the ACC (and HR) values
+   * @param hr_values_diffs_sum Sum of the HR values differences
+   * @param hr_values_diff_squared_root Square root of the square of differences (of each value and their global average)
+   * @param fitness_buffer Buffer the correlation coefficient of every individual is written to (NaN for constant formulas)
+   *
+   * @return true if the launches have been enqueued, false if the OpenCL calls failed
+   */
+  bool evaluate_population(
+      const cl::CommandQueue& device_queue, const cl::Buffer& generation_buffer,
+      const cl::Buffer& acc_buffer, const cl::Buffer& hr_values_diffs_buffer,
+      const size_t values_count, const float_t hr_values_diffs_sum,
+      const float_t hr_values_diff_squared_root,
+      const cl::Buffer& fitness_buffer) const noexcept;
+
   /**
    * Compute the correlation formula of the initial ACC and HR values using a genetic algorithm 
    *
-   * @param acc_values initial ACC values
-   * @param hr_values_diffs Vector where each element represents a difference between the initial HR value and their global average
+   * @param acc_values initial ACC values. The device reads them in place, they are never copied on the host
+   * @param hr_values_diffs Values where each element represents a difference between the initial HR value and their global average
    * @param hr_values_diff_squared_root Square root of the square of differences (of each value and their global average)
    *
    * @return Pair of values. First represents the newly generated HR values and the second represents a syntax tree of nodes with the following structure: 
    * [0, root (operation), left_child (operand), right_child (operand), root, ...]
    */
-  std::pair<std::vector<float_t>, std::vector<float_t>>
+  std::pair<DataPreprocessing::SubjectSeries, std::vector<float_t>>
   compute_correlation_formula(
-      std::vector<float_t>& acc_values, std::vector<float_t>& hr_values_diffs,
+      const DataPreprocessing::SeriesView acc_values,
+      const DataPreprocessing::SeriesView hr_values_diffs,
       const float_t hr_values_diff_squared_root) const noexcept;
 
   /**
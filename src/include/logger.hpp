@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <string>
 
 #include "errors.hpp"
@@ -26,12 +27,14 @@ extern enum LOG_LEVEL APP_LOGGING_LEVEL;
 
 /**
  * Custom logger class.
- * All info is logged to BOTH stdout and a log file specified in the constructor
+ * All info is logged to BOTH stdout and a log file specified in the constructor.
+ * The logger is thread-safe, messages logged from different threads are never interleaved
  */
 class Logger {
  private:
   std::string _log_file_path;
   std::ofstream _log_file_stream;
+  std::mutex _mutex;
 
   Logger() noexcept;
 
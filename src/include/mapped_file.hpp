@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace DataPreprocessing {
+
+/**
+ * Read-only memory mapping of a whole source file.
+ * If the file cannot be mapped (empty file, unsupported platform, ...), the instance stays unmapped and the caller is expected to fall back to stream reading
+ */
+class MappedFile {
+ private:
+  std::string _file_path;
+  const char* _data = nullptr;
+  size_t _size = 0;
+
+  /** Release the mapping, if there is any */
+  void unmap() noexcept;
+
+ public:
+  MappedFile() noexcept = default;
+
+  /**
+   * Class Constructor
+   *
+   * @param file_path Path to the file to be mapped
+   */
+  explicit MappedFile(const std::string& file_path) noexcept;
+
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  virtual ~MappedFile();
+
+  /** @return true if the file contents are mapped into memory */
+  bool is_mapped() const noexcept { return _data != nullptr; }
+
+  /** @return Pointer to the first byte of the file */
+  const char* begin() const noexcept { return _data; }
+
+  /** @return Pointer one past the last byte of the file */
+  const char* end() const noexcept { return _data + _size; }
+
+  /** @return Size of the mapped file in bytes */
+  size_t size() const noexcept { return _size; }
+
+  /** @return Path of the mapped file */
+  const std::string& file_path() const noexcept { return _file_path; }
+};
+
+}  // namespace DataPreprocessing
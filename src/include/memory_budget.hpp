@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+namespace DataPreprocessing {
+
+/** Estimated ratio of the memory needed for the parsed values of a compressed source file to its size */
+constexpr size_t COMPRESSED_MEMORY_FACTOR = 2;
+
+/**
+ * Memory budget shared by the subjects processed in parallel.
+ * A subject is admitted only if its estimated memory fits into what is left of the budget. A subject is always admitted if no other one holds any memory, so that a single subject larger than the budget still gets processed
+ */
+class MemoryBudget {
+ private:
+  const size_t _budget;  // In bytes, 0 means unlimited
+  size_t _used = 0;
+  size_t _holders = 0;
+  std::mutex _mutex;
+  std::condition_variable _released;
+
+ public:
+  /**
+   * Class Constructor
+   *
+   * @param budget Budget in bytes, 0 means unlimited
+   */
+  explicit MemoryBudget(const size_t budget) noexcept;
+
+  MemoryBudget(MemoryBudget const&) = delete;
+  MemoryBudget& operator=(MemoryBudget const&) = delete;
+
+  /**
+   * Reserve memory from the budget. Blocks until the memory fits
+   *
+   * @param bytes Memory to be reserved
+   */
+  void acquire(const size_t bytes) noexcept;
+
+  /**
+   * Return memory reserved by @code acquire into the budget
+   *
+   * @param bytes Memory to be returned
+   */
+  void release(const size_t bytes) noexcept;
+
+  /**
+   * Estimate the peak memory needed to preprocess a subject - its mapped source files, or the parsed values of its compressed source files
+   *
+   * @param acc_file_path Path to the ACC source file
+   * @param hr_file_path Path to the HR source file
+   *
+   * @return Estimated memory in bytes
+   */
+  static size_t estimate_subject_memory(
+      const std::string& acc_file_path,
+      const std::string& hr_file_path) noexcept;
+};
+
+}  // namespace DataPreprocessing
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "avx.hpp"
+
+namespace options {
+
+/** Argument which runs the parser benchmark instead of the correlation search */
+const std::string BENCHMARK_ARG = "--bench";
+
+/** Argument setting the number of subjects whose files are read ahead (0 disables the read-ahead) */
+const std::string PREFETCH_ARG = "--prefetch";
+
+/** Argument setting the number of subjects processed in parallel */
+const std::string JOBS_ARG = "--jobs";
+
+/** Argument setting the memory budget (in MB) of the subjects processed in parallel (0 means unlimited) */
+const std::string MEMORY_BUDGET_ARG = "--memory-budget";
+
+/** Argument setting the length (in seconds) of the rolling correlation windows (0 disables the rolling correlation) */
+const std::string WINDOW_ARG = "--window";
+
+/** Argument setting the step (in seconds) between two rolling correlation windows */
+const std::string STEP_ARG = "--step";
+
+/** Argument setting the largest lag (in seconds, both directions) between the ACC and HR values to be scanned (0 disables the lag scan) */
+const std::string MAX_LAG_ARG = "--max-lag";
+
+/** Argument which realigns the ACC and HR values by the best scanned lag before the correlation formula search */
+const std::string REALIGN_ARG = "--realign";
+
+/** Argument which reports the correlations of every period size from 1 to the given one (in seconds), derived from a single preprocessing */
+const std::string SWEEP_ARG = "--sweep";
+
+/** Argument which calculates the Spearman's rank correlations (robust to outliers) next to the initial Pearson's correlations */
+const std::string SPEARMAN_ARG = "--spearman";
+
+/** Argument selecting the summation method of the float reductions ("naive", "pairwise" or "neumaier") */
+const std::string SUMMATION_ARG = "--summation";
+
+/** Argument which runs the summation accuracy and throughput benchmark instead of the correlation search */
+const std::string SUM_BENCHMARK_ARG = "--bench-sum";
+
+/** Options of a single program run, parsed from the command line arguments */
+struct RunOptions {
+  uint8_t period_size = 1;
+  bool benchmark = false;
+  size_t prefetch_depth = 1;
+  size_t jobs = 1;
+  size_t memory_budget_mb = 0;
+  size_t window_seconds = 0;
+  size_t step_seconds = 10;
+  size_t max_lag_seconds = 0;
+  bool realign = false;
+  uint8_t sweep_max_period = 0;
+  avx::SUMMATION summation = avx::SUMMATION::PAIRWISE;
+  bool sum_benchmark = false;
+  bool spearman = false;
+};
+
+/**
+ * Parse the command line arguments. The only positional argument is the period size, named arguments have the "--name=value" format.
+ * Invalid arguments are reported as warnings and the respective defaults are kept
+ *
+ * @param argc Number of the arguments (including the program name)
+ * @param argv Arguments
+ *
+ * @return Options of the run
+ */
+RunOptions parse_run_options(const int argc, char* argv[]) noexcept;
+}  // namespace options
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "series.hpp"
+
+namespace DataPreprocessing {
+
+/**
+ * Prefix sums of values normalized with the base period (1 second), built once per subject.
+ * The normalized values of any longer period are derived from it in O(n/period) - a period is the average of its base periods,
+ * so no source file needs to be parsed or normalized again
+ */
+class PeriodPyramid {
+ private:
+  /** Sum of the first i base values at index i (double, so that long series do not lose precision) */
+  std::vector<double> _prefix_sums;
+
+ public:
+  /**
+   * Class Constructor
+   *
+   * @param values Values normalized with the period of 1 second (output of normalize_acc_values/normalize_hr_values)
+   */
+  explicit PeriodPyramid(const SeriesView values);
+
+  /** Number of the base values */
+  size_t size() const noexcept { return _prefix_sums.size() - 1; }
+
+  /**
+   * Derive the normalized values of a period size
+   *
+   * @param period_size Selected size of watched period (e.g. 1s, 10s, 20s, ...)
+   * @param keep_incomplete Keep the last, incomplete period (as normalize_acc_values does), or drop it (as normalize_hr_values does)
+   *
+   * @return Vector of normalized values, same periods as if the source file was normalized with @param period_size from the start offset of the base values
+   */
+  SubjectSeries derive(const uint8_t period_size,
+                       const bool keep_incomplete) const;
+};
+
+}  // namespace DataPreprocessing
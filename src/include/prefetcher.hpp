@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace DataPreprocessing {
+
+/**
+ * Background read-ahead of the source files of the subjects that are going to be processed next.
+ * A dedicated thread hints the kernel (posix_fadvise/madvise WILLNEED) and pre-faults the files into the page cache, so that the disk works while the current subject is being computed.
+ * Every prefetched file occupies the page cache until it is processed, so the look-ahead depth should stay small
+ */
+class SubjectPrefetcher {
+ private:
+  /** ACC and HR source file paths of all subjects, in the order of processing */
+  const std::vector<std::pair<std::string, std::string>> _subjects;
+
+  /** Number of subjects to be read ahead of the current one */
+  const size_t _look_ahead;
+
+  /** Subjects below this index should be prefetched */
+  size_t _requested = 0;
+
+  /** Subjects below this index have been prefetched (or skipped) */
+  size_t _prefetched = 0;
+
+  std::atomic<bool> _stop{false};
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  std::thread _worker;
+
+  /** Body of the background thread */
+  void run() noexcept;
+
+  /**
+   * Read a file into the page cache. Its binary cache is read instead, if it exists
+   *
+   * @param file_path Path to the source file
+   *
+   * @return Number of bytes read ahead
+   */
+  size_t prefetch_file(const std::string& file_path) const noexcept;
+
+ public:
+  /**
+   * Class Constructor. Starts the background thread, unless the look-ahead is zero
+   *
+   * @param subjects ACC and HR source file paths of all subjects, in the order of processing
+   * @param look_ahead Number of subjects to be read ahead of the current one
+   */
+  SubjectPrefetcher(
+      const std::vector<std::pair<std::string, std::string>>& subjects,
+      const size_t look_ahead);
+
+  SubjectPrefetcher(SubjectPrefetcher const&) = delete;
+  SubjectPrefetcher& operator=(SubjectPrefetcher const&) = delete;
+
+  /** Class Destructor. Stops the background thread */
+  ~SubjectPrefetcher();
+
+  /**
+   * Signal that a subject is being processed, so that the following subjects (up to the look-ahead) get prefetched
+   *
+   * @param subject Index of the subject that is being processed
+   */
+  void begin_subject(const size_t subject) noexcept;
+};
+
+}  // namespace DataPreprocessing
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "series.hpp"
+
+namespace DataPreprocessing {
+
+/** Number of bits sorted by one counting sort pass of the rank computation */
+constexpr size_t RANK_RADIX_BITS = 8;
+
+/** Smallest number of values sorted by one worker of a counting sort pass */
+constexpr size_t RANK_MIN_CHUNK_SIZE = 1 << 16;
+
+/**
+ * Map a float to an unsigned key with the same order (negative values are flipped, positive ones get the sign bit set)
+ *
+ * @param value Value to be mapped (not NaN)
+ *
+ * @return Key of the value. Equal values (including -0 and +0) map to equal keys
+ */
+uint32_t rank_key(const float_t value) noexcept;
+
+/**
+ * Calculate the ranks of values (1 = the smallest value) in linear time. The values are ordered by a parallel LSD radix sort -
+ * RANK_RADIX_BITS wide counting sort passes over the keys of rank_key, the passes in which all of the keys share the digit are skipped.
+ * Tied values get the average of their ranks, so the ranks always sum up to n * (n + 1) / 2.
+ * Ranks are exact up to 2^23 values
+ *
+ * @param values Values to be ranked (not NaN)
+ *
+ * @return Rank of every value, in the order of @param values
+ */
+SubjectSeries rank_values(const SeriesView values);
+}  // namespace DataPreprocessing
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace DataPreprocessing {
+
+/** Alignment of the series values in bytes (cache line and AVX-512 register size) */
+constexpr size_t SERIES_ALIGNMENT = 64;
+
+class SeriesView;
+
+/**
+ * Owning series of measured (or derived) values of a subject, aligned at SERIES_ALIGNMENT bytes.
+ * The series is move-only, so that its values are never duplicated by accident - read it through SeriesView, or move the ownership
+ */
+class SubjectSeries {
+ private:
+  float_t* _data = nullptr;
+  size_t _size = 0;
+  size_t _capacity = 0;
+
+  /**
+   * Allocate aligned memory for the values
+   *
+   * @param count Number of the values
+   *
+   * @return Pointer to the allocated memory. Throws std::bad_alloc if it could not have been allocated
+   */
+  static float_t* allocate(const size_t count);
+
+ public:
+  SubjectSeries() noexcept = default;
+
+  /**
+   * Class Constructor
+   *
+   * @param size Number of the values
+   * @param value Initial value of all of the values
+   */
+  explicit SubjectSeries(const size_t size, const float_t value = 0.0f);
+
+  SubjectSeries(SubjectSeries const&) = delete;
+  SubjectSeries& operator=(SubjectSeries const&) = delete;
+
+  SubjectSeries(SubjectSeries&& other) noexcept;
+  SubjectSeries& operator=(SubjectSeries&& other) noexcept;
+
+  ~SubjectSeries();
+
+  /**
+   * Explicitly copy values into a new series
+   *
+   * @param values Values to be copied
+   *
+   * @return New series with the same values
+   */
+  static SubjectSeries copy_of(const SeriesView& values);
+
+  /**
+   * Change the number of the values. Existing values are kept, new values are set to zero
+   *
+   * @param size New number of the values
+   */
+  void resize(const size_t size);
+
+  float_t* data() noexcept { return _data; }
+
+  const float_t* data() const noexcept { return _data; }
+
+  size_t size() const noexcept { return _size; }
+
+  bool empty() const noexcept { return _size == 0; }
+
+  float_t& operator[](const size_t i) noexcept { return _data[i]; }
+
+  const float_t& operator[](const size_t i) const noexcept { return _data[i]; }
+
+  float_t* begin() noexcept { return _data; }
+
+  float_t* end() noexcept { return _data + _size; }
+
+  const float_t* begin() const noexcept { return _data; }
+
+  const float_t* end() const noexcept { return _data + _size; }
+};
+
+/**
+ * Non-owning, read-only view of contiguous values (a SubjectSeries or a std::vector). The viewed values have to outlive the view
+ */
+class SeriesView {
+ private:
+  const float_t* _data = nullptr;
+  size_t _size = 0;
+
+ public:
+  SeriesView() noexcept = default;
+
+  SeriesView(const float_t* data, const size_t size) noexcept
+      : _data(data), _size(size) {}
+
+  SeriesView(const SubjectSeries& series) noexcept
+      : _data(series.data()), _size(series.size()) {}
+
+  SeriesView(const std::vector<float_t>& values) noexcept
+      : _data(values.data()), _size(values.size()) {}
+
+  /**
+   * View of a part of the values
+   *
+   * @param offset Index of the first value
+   * @param count Number of the values (clamped to the end of this view)
+   *
+   * @return New view
+   */
+  SeriesView subview(const size_t offset, const size_t count) const noexcept {
+    const size_t begin = offset < _size ? offset : _size;
+    return SeriesView(_data + begin,
+                      count < _size - begin ? count : _size - begin);
+  }
+
+  const float_t* data() const noexcept { return _data; }
+
+  size_t size() const noexcept { return _size; }
+
+  bool empty() const noexcept { return _size == 0; }
+
+  const float_t& operator[](const size_t i) const noexcept { return _data[i]; }
+
+  const float_t* begin() const noexcept { return _data; }
+
+  const float_t* end() const noexcept { return _data + _size; }
+};
+
+}  // namespace DataPreprocessing
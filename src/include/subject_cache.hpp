@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+
+namespace DataPreprocessing {
+
+/** Identification of the binary cache files */
+constexpr char CACHE_MAGIC[8] = {'P', 'P', 'R', 'C', 'A', 'C', 'H', 'E'};
+
+/** Version of the binary cache layout. Caches of other versions are rebuilt (2: start epochs are UTC) */
+constexpr uint32_t CACHE_VERSION = 2;
+
+/**
+ * Header of the binary cache file. It is followed by @code columns contiguous columns of @code count one byte values each (SoA layout)
+ */
+struct SubjectCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t columns;       // 3 for ACC (X, Y, Z), 1 for HR
+  uint32_t is_signed;     // Values are int8_t if set, uint8_t otherwise
+  uint32_t sample_freq;   // Samples per second of the source measurements
+  int64_t start_epoch;    // Timestamp of the first measurement in seconds
+  uint64_t count;         // Number of values in every column
+  uint64_t source_size;   // Size of the source CSV file in bytes
+  int64_t source_mtime;   // Last modification time of the source CSV file
+  uint64_t source_checksum;
+};
+
+/**
+ * Binary columnar cache of a parsed source CSV file, stored next to it with the CACHE_FILE_FORMAT extension.
+ * The cache is memory mapped, so that loading it does not need any text parsing
+ */
+class SubjectCache {
+ private:
+  MappedFile _file;
+  const SubjectCacheHeader* _header = nullptr;
+
+ public:
+  SubjectCache() noexcept = default;
+
+  /**
+   * Class Constructor. Maps the cache of the source file, if it exists and is up to date with the source file
+   *
+   * @param source_path Path to the source CSV file
+   * @param columns Expected number of the columns
+   */
+  SubjectCache(const std::string& source_path, const uint32_t columns) noexcept;
+
+  /** @return true if the cache is mapped and up to date with its source file */
+  bool is_valid() const noexcept { return _header != nullptr; }
+
+  /** @return Header of the cache. Only valid if @code is_valid() */
+  const SubjectCacheHeader& header() const noexcept { return *_header; }
+
+  /**
+   * Raw values of one column of the cache. Only valid if @code is_valid()
+   *
+   * @param column Index of the column
+   *
+   * @return Pointer to the first value (int8_t or uint8_t, based on the header)
+   */
+  const char* column_data(const size_t column) const noexcept {
+    return _file.begin() + sizeof(SubjectCacheHeader) +
+           column * _header->count;
+  }
+
+  /**
+   * Convert one column of the cache into floats
+   *
+   * @param column Index of the column
+   * @param offset Number of values to be skipped at the beginning of the column
+   *
+   * @return Values of the column
+   */
+  std::vector<float_t> column_values(const size_t column,
+                                     const size_t offset = 0) const noexcept;
+
+  /**
+   * Get the cache file path belonging to a source file (e.g. ACC_001.csv -> ACC_001.bin)
+   *
+   * @param source_path Path to the source CSV file
+   *
+   * @return Path to the cache file
+   */
+  static std::string cache_path(const std::string& source_path) noexcept;
+
+  /**
+   * Calculate a checksum of a memory block (64 bit FNV-1a over 8 byte words)
+   *
+   * @param begin Beginning of the memory block
+   * @param end End of the memory block
+   *
+   * @return Checksum of the block
+   */
+  static uint64_t checksum(const char* begin, const char* end) noexcept;
+
+  /**
+   * Convert parsed values of a source file into its binary cache. The file is written under a temporary name and renamed afterwards, so that a cache is never seen half written
+   *
+   * @param source_path Path to the source CSV file
+   * @param start_epoch Timestamp of the first measurement in seconds
+   * @param sample_freq Samples per second of the measurements
+   * @param columns Parsed values, all of the same length
+   * @param is_signed Store the values as int8_t (true) or uint8_t (false)
+   *
+   * @return true if the cache has been written, false if the values do not fit into the format or the file could not have been written
+   */
+  static bool write(const std::string& source_path, const int64_t start_epoch,
+                    const uint32_t sample_freq,
+                    const std::vector<const std::vector<float_t>*>& columns,
+                    const bool is_signed) noexcept;
+
+  /**
+   * Write values already encoded in the cache format into the binary cache of a source file, the same way as @code write
+   *
+   * @param source_path Path to the source CSV file
+   * @param start_epoch Timestamp of the first measurement in seconds
+   * @param sample_freq Samples per second of the measurements
+   * @param columns Number of the columns
+   * @param data Encoded values (int8_t or uint8_t), column after column
+   * @param is_signed The values are int8_t (true) or uint8_t (false)
+   *
+   * @return true if the cache has been written, false otherwise
+   */
+  static bool write_encoded(const std::string& source_path,
+                            const int64_t start_epoch,
+                            const uint32_t sample_freq, const uint32_t columns,
+                            const std::vector<char>& data,
+                            const bool is_signed) noexcept;
+};
+
+}  // namespace DataPreprocessing
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <string>
-#include <vector>
 #include "math.h"
+#include "series.hpp"
 
 namespace svg {
 
@@ -14,8 +14,9 @@ namespace svg {
    * @param initial_values Vector of the initial values
    * @param correlation_formula Correlation formula that was found in a string format
    */
-void plot_correlation_values(const std::string& filepath,
-                             const std::vector<float_t>& generated_values,
-                             const std::vector<float_t>& initial_values,
-                             const std::string& correlation_formula) noexcept;
+void plot_correlation_values(
+    const std::string& filepath,
+    const DataPreprocessing::SeriesView generated_values,
+    const DataPreprocessing::SeriesView initial_values,
+    const std::string& correlation_formula) noexcept;
 }  // namespace svg
@@ -16,6 +16,9 @@ enum WARNINGS {
   PARAMETER_WAS_EMPTY = 4,
   COULD_NOT_PARSE_CMD_ARGS = 5,
   INVALID_PERIOD_SIZE = 6,
+  FILE_NOT_MAPPED = 7,
+  CACHE_NOT_WRITTEN = 8,
+  PROGRAM_CACHE_NOT_USED = 9,
 };
 
 /** Map of all available warnings and their respective messages */
@@ -33,6 +36,15 @@ const std::unordered_map<size_t, std::string> WARNINGS_MAP = {
     {INVALID_PERIOD_SIZE,
      "Invalid period size specified. Supported period size is between 1 and " +
          std::to_string(MAX_SUPPORTED_PERIOD_SIZE)},
+    {FILE_NOT_MAPPED,
+     "File could not have been memory mapped. Falling back to stream "
+     "reading"},
+    {CACHE_NOT_WRITTEN,
+     "Binary cache could not have been written. The source file will be "
+     "parsed"},
+    {PROGRAM_CACHE_NOT_USED,
+     "Cached OpenCL program binary could not have been used. The program "
+     "will be built from the source"},
 
 };
 }  // namespace warnings
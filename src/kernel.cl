@@ -6,13 +6,71 @@ __constant float DIV_FLOAT_REPRESENTATION = 4.0f;
 
 __constant float NORMALIZATION_VAL = 255.0f;
 
-// Input MUST BE aligned at a power of 2's size
-__kernel void parallel_prefix_sum(__global float *input, int idx_offset) {
-    int idx = (get_global_id(0) + 1) * idx_offset - 1;
-    int idx_next = idx - idx_offset / 2;
+#ifdef cl_khr_subgroups
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#endif
 
-    // printf("IDX=%d, IDX2=%d => %f with %f\n", idx, idx_next, input[idx], input[idx_next]);
-    input[idx] = input[idx] + input[idx_next]; // Overall sum stored in the last element
+// Neumaier's compensated addition, the rounding error is accumulated separately
+inline void neumaier_add(float *sum, float *compensation, float value) {
+  float total = *sum + value;
+  *compensation += fabs(*sum) >= fabs(value) ? (*sum - total) + value
+                                             : (value - total) + *sum;
+  *sum = total;
+}
+
+// One stage of a two-stage sum reduction. Every work item sums a grid-stride
+// slice of the input in registers (compensated if requested), the slices are
+// reduced inside the work-group and the sum of the group is written to
+// partials[group]. The first stage runs many groups, the second a single group
+// over their partials. The local size has to be a power of 2, the input may be
+// of any length
+__kernel void reduce_sum(__global const float *input, int len, __global float *partials, __local float *scratch, int compensated) {
+  const int global_size = get_global_size(0);
+  float sum = 0.0f;
+  float compensation = 0.0f;
+
+  if (compensated) {
+    for (int i = get_global_id(0); i < len; i += global_size) {
+      neumaier_add(&sum, &compensation, input[i]);
+    }
+  } else {
+    for (int i = get_global_id(0); i < len; i += global_size) {
+      sum += input[i];
+    }
+  }
+  sum += compensation;
+
+#ifdef cl_khr_subgroups
+  // Sub-groups reduce in registers, only their sums go through local memory
+  sum = sub_group_reduce_add(sum);
+  if (get_sub_group_local_id() == 0) {
+    scratch[get_sub_group_id()] = sum;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  if (get_local_id(0) == 0) {
+    float group_sum = 0.0f;
+    for (uint i = 0; i < get_num_sub_groups(); ++i) {
+      group_sum += scratch[i];
+    }
+    partials[get_group_id(0)] = group_sum;
+  }
+#else
+  const int local_id = get_local_id(0);
+  scratch[local_id] = sum;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for (int offset = get_local_size(0) / 2; offset > 0; offset /= 2) {
+    if (local_id < offset) {
+      scratch[local_id] += scratch[local_id + offset];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if (local_id == 0) {
+    partials[get_group_id(0)] = scratch[0];
+  }
+#endif
 }
 
 
@@ -24,24 +82,24 @@ __kernel void calculate_correlation_acc_values(__global float *nominator, __glob
   acc_diffs_squared[id] = acc_diff * acc_diff;
 }
 
-__kernel void generate_hr_values(__global float* generation, int row_idx, int nodes_count, __global float* acc_values, __global float* generated_values) {
-  const size_t id = get_global_id(0);
-  const size_t node_size = 3; // parent, left and right child
+// Value of the formula of one individual for one ACC value. The individual
+// is a sequence of nodes (parent, left and right child), their results are
+// summed up
+inline float evaluate_individual(__global const float *individual, int nodes_count, float acc_value) {
+  const int node_size = 3; // parent, left and right child
 
   float val = 0.0f;
 
   for(int i = 0; i < nodes_count; i += node_size) {
-    size_t idx = (row_idx * nodes_count * node_size) + i;
-    float op = generation[idx]; 
+    float op = individual[i];
 
-    float op_l = generation[idx + 1]; 
+    float op_l = individual[i + 1];
     if (op_l == X_FLOAT_REPRESENTATION){
-      op_l = acc_values[id];
+      op_l = acc_value;
     }
 
-    float op_r = generation[idx + 2]; 
-    
-    // printf("[%d]: %f, [%d]: %f, [%d]: %f\n", idx, op, idx + 1, op_l, idx + 2, op_r);
+    float op_r = individual[i + 2];
+
     if(op == ADD_FLOAT_REPRESENTATION){ 
       val += (op_l + op_r);
     }
@@ -63,11 +121,166 @@ __kernel void generate_hr_values(__global float* generation, int row_idx, int no
       // Should not happen, indicates that an invalid operation was generated
     }
   }
-  
-  generated_values[id] = val;
+
+  return val;
+}
+
+__kernel void generate_hr_values(__global float* generation, int row_idx, int nodes_count, __global float* acc_values, __global float* generated_values) {
+  const size_t id = get_global_id(0);
+
+  generated_values[id] = evaluate_individual(generation + row_idx * nodes_count, nodes_count, acc_values[id]);
   // printf("GPU %d done, new value: %f\n", id, generated_values[id]);
 }
 
+// 2D launch - individuals along the first dimension (local size 1), their
+// samples along the second. Every work item evaluates the formula of its
+// individual for a grid-stride slice of the samples and gathers the moments of
+// the values shifted by the value of the first sample (x = value - shift,
+// y = HR difference). The moments are reduced inside the work-group into
+// partials[(individual * groups + group) * 3 + {0, 1, 2}] = sum of x, x^2, x * y.
+// The local size of the second dimension has to be a power of 2
+__kernel void evaluate_population(__global const float *generation, int nodes_count, __global const float *acc_values, __global const float *hr_values_diffs, int len, __global float *partials, __local float *scratch) {
+  const int individual_id = get_global_id(0);
+  __global const float *individual = generation + individual_id * nodes_count;
+  const float shift = evaluate_individual(individual, nodes_count, acc_values[0]);
+
+  float x_sum = 0.0f;
+  float xx_sum = 0.0f;
+  float xy_sum = 0.0f;
+
+  const int global_size = get_global_size(1);
+  for (int i = get_global_id(1); i < len; i += global_size) {
+    float x = evaluate_individual(individual, nodes_count, acc_values[i]) - shift;
+    x_sum += x;
+    xx_sum += x * x;
+    xy_sum += x * hr_values_diffs[i];
+  }
+
+  const int local_id = get_local_id(1);
+  const int local_size = get_local_size(1);
+  __local float *x_scratch = scratch;
+  __local float *xx_scratch = scratch + local_size;
+  __local float *xy_scratch = scratch + 2 * local_size;
+
+  x_scratch[local_id] = x_sum;
+  xx_scratch[local_id] = xx_sum;
+  xy_scratch[local_id] = xy_sum;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for (int offset = local_size / 2; offset > 0; offset /= 2) {
+    if (local_id < offset) {
+      x_scratch[local_id] += x_scratch[local_id + offset];
+      xx_scratch[local_id] += xx_scratch[local_id + offset];
+      xy_scratch[local_id] += xy_scratch[local_id + offset];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if (local_id == 0) {
+    __global float *moments = partials + (individual_id * get_num_groups(1) + get_group_id(1)) * 3;
+    moments[0] = x_scratch[0];
+    moments[1] = xx_scratch[0];
+    moments[2] = xy_scratch[0];
+  }
+}
+
+// One work item per individual - sums the moments of its groups and computes
+// the Pearson's correlation coefficient of its values and the HR values
+__kernel void population_fitness(__global const float *partials, int groups, int len, float hr_diffs_sum, float hr_diff_square_root, __global float *fitness) {
+  const int individual_id = get_global_id(0);
+  __global const float *moments = partials + individual_id * groups * 3;
+
+  float x_sum = 0.0f;
+  float xx_sum = 0.0f;
+  float xy_sum = 0.0f;
+  for (int group = 0; group < groups; ++group) {
+    x_sum += moments[group * 3];
+    xx_sum += moments[group * 3 + 1];
+    xy_sum += moments[group * 3 + 2];
+  }
+
+  // Sums of (x - avg_x) * y and of (x - avg_x)^2 from the shifted sums
+  float nominator = xy_sum - x_sum * hr_diffs_sum / len;
+  float acc_diff_squared = fmax(xx_sum - x_sum * x_sum / len, 0.0f);
+
+  fitness[individual_id] = nominator / (sqrt(acc_diff_squared) * hr_diff_square_root);
+}
+
+// Philox4x32-10 counter-based generator (Random123) - 4 random words of a
+// counter and a key, no state is kept between the calls
+__constant uint PHILOX_M0 = 0xD2511F53;
+__constant uint PHILOX_M1 = 0xCD9E8D57;
+__constant uint PHILOX_W0 = 0x9E3779B9;
+__constant uint PHILOX_W1 = 0xBB67AE85;
+
+inline uint4 philox4x32(uint4 counter, uint2 key) {
+  for (int round = 0; round < 10; ++round) {
+    uint hi0 = mul_hi(PHILOX_M0, counter.x);
+    uint lo0 = PHILOX_M0 * counter.x;
+    uint hi1 = mul_hi(PHILOX_M1, counter.z);
+    uint lo1 = PHILOX_M1 * counter.z;
+
+    counter = (uint4)(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);
+    key += (uint2)(PHILOX_W0, PHILOX_W1);
+  }
+
+  return counter;
+}
+
+// Uniform float in [0, 1) from the upper 24 bits of a random word
+inline float uniform_float(uint word) {
+  return (float)(word >> 8) * (1.0f / 16777216.0f);
+}
+
+// 2D launch over (individual, node). Every node from the crossover index on
+// gets a random operation, a left operand (X or a number) and a right operand,
+// the same distributions as the initial generation. The counter is (individual,
+// node, iteration), so the generation of a run is reproducible from its seed
+__kernel void mutate_population(__global float *generation, int nodes_count, __global const int *crossover_idx, uint seed_lo, uint seed_hi, uint iteration) {
+  const int node_size = 3;
+  const uint individual_id = get_global_id(0);
+  const uint node = get_global_id(1);
+  const int idx = node * node_size;
+
+  if (idx < *crossover_idx || idx + node_size > nodes_count) {
+    return;
+  }
+
+  const uint4 random = philox4x32((uint4)(individual_id, node, iteration, 0), (uint2)(seed_lo, seed_hi));
+  __global float *individual_node = generation + individual_id * nodes_count + idx;
+
+  individual_node[0] = (float)(1 + (random.x >> 30)); // 1, 2, 3 or 4
+  individual_node[1] = (random.y & 1) == 0 ? X_FLOAT_REPRESENTATION : 0.5f * uniform_float(random.z);
+  individual_node[2] = 0.5f * uniform_float(random.w);
+}
+
+// Single work item - picks the individual whose correlation is the closest to
+// the initial one, keeps it if it is better than the best one so far, and
+// moves the crossover index (further on improvement, back otherwise)
+__kernel void select_best(__global const float *fitness, int population, float initial_correlation, __global const float *generation, int nodes_count, __global float *best_correlation, __global float *best_fit, __global int *crossover_idx) {
+  const int node_size = 3;
+  int best_individual = -1;
+  float best = *best_correlation;
+
+  for (int i = 0; i < population; ++i) {
+    if (fabs(initial_correlation - fitness[i]) < fabs(initial_correlation - best)) {
+      best = fitness[i];
+      best_individual = i;
+    }
+  }
+
+  if (best_individual < 0) { // Haven't found a better fit in this iteration
+    *crossover_idx = *crossover_idx - node_size == 0 ? *crossover_idx : *crossover_idx - node_size;
+    return;
+  }
+
+  *best_correlation = best;
+  for (int i = 0; i < nodes_count; ++i) {
+    best_fit[i] = generation[best_individual * nodes_count + i];
+  }
+  *crossover_idx = *crossover_idx + node_size >= nodes_count - 1 ? *crossover_idx : *crossover_idx + node_size;
+}
+
 __kernel void perform_crossover(__global float* generation, int crossover_idx, int nodes_count){
   const size_t id = get_global_id(0);
   const size_t node_size = 3;
@@ -64,6 +64,9 @@ void Logger::log_message(enum LOG_LEVEL level,
     return;
   }
 
+  // Also guards the static buffer returned by std::localtime
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
   const time_t time = std::time(nullptr);
   const std::tm* timestamp = std::localtime(&time);
 
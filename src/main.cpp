@@ -1,14 +1,24 @@
 #include <stdio.h>
 #include <array>
+#include <atomic>
 #include <execution>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include "include/avx.hpp"
+#include "include/benchmark.hpp"
 #include "include/constants.hpp"
 #include "include/data_preprocessing.hpp"
 #include "include/errors.hpp"
+#include "include/fft.hpp"
 #include "include/gpu.hpp"
 #include "include/logger.hpp"
+#include "include/memory_budget.hpp"
+#include "include/options.hpp"
+#include "include/period_pyramid.hpp"
+#include "include/prefetcher.hpp"
 #include "include/svg.hpp"
 #include "include/warnings.hpp"
 
@@ -27,6 +37,24 @@ Logging::Logger& logger = Logging::Logger::get_instance();
  */
 std::vector<std::pair<std::string, std::string>> valid_subject_ids{};
 
+/**
+ * Use a compressed variant of a source file (.csv.gz or .csv.zst), if the plain one does not exist
+ *
+ * @param file_path Path to the plain source file. Gets the compression extension appended, if only the compressed variant exists
+ */
+void resolve_compressed_source(std::string& file_path) {
+  if (std::filesystem::exists(file_path)) {
+    return;
+  }
+
+  for (const std::string& format : {GZIP_FILE_FORMAT, ZSTD_FILE_FORMAT}) {
+    if (std::filesystem::exists(file_path + format)) {
+      file_path.append(format);
+      return;
+    }
+  }
+}
+
 /**
  * Validate all needed resources
  *
@@ -74,6 +102,9 @@ int8_t validate_resources() {
         .append(curr_file_number)
         .append(SOURCE_FILE_FORMAT);
 
+    resolve_compressed_source(acc_file_path);
+    resolve_compressed_source(hr_file_path);
+
     if (!std::filesystem::exists(acc_file_path) ||
         !std::filesystem::exists(hr_file_path)) {
       logger.log_warning(warnings::FILE_NOT_FOUND);
@@ -105,6 +136,421 @@ int8_t validate_resources() {
   return RETURN_OK;
 }
 
+/**
+ * Export the rolling correlations of all of the axes into a CSV file (one row per window)
+ *
+ * @param filename Path to the output file
+ * @param step_seconds Time between the beginnings of two windows (in seconds)
+ * @param correlations Rolling correlations of the X, Y and Z axes, all of the same length
+ *
+ * @return true if the file has been written
+ */
+bool export_rolling_correlations(
+    const std::string& filename, const size_t step_seconds,
+    const std::array<std::vector<float_t>, DataPreprocessing::ACC_NO_VALUES>&
+        correlations) {
+  std::ofstream output(filename);
+  if (!output.is_open()) {
+    logger.log_error(errors::ERRORS::COULD_NOT_OPEN_FILE_HANDLE,
+                     "(Filename: " + filename + ")");
+    return false;
+  }
+
+  output << "window_start_s,x,y,z\n";
+  for (size_t i = 0; i < correlations[0].size(); ++i) {
+    output << i * step_seconds << ',' << correlations[0][i] << ','
+           << correlations[1][i] << ',' << correlations[2][i] << '\n';
+  }
+
+  return output.good();
+}
+
+/**
+ * Center the HR values - the statistics needed by the correlation calculations
+ *
+ * @param hr_values Normalized HR values
+ * @param hr_values_diffs Series the differences of the values and their average are written to (resized to the values)
+ *
+ * @return Square root of the sum of the squared differences, std::nullopt if the values were empty
+ */
+std::optional<float_t> center_hr_values(
+    const DataPreprocessing::SeriesView hr_values,
+    DataPreprocessing::SubjectSeries& hr_values_diffs) {
+  const std::optional<float_t> tmp = avx::vector_sum_avx2(hr_values);
+  if (tmp == std::nullopt) {
+    return std::nullopt;
+  }
+
+  const float_t hr_avg = tmp.value() / hr_values.size();
+
+  hr_values_diffs = DataPreprocessing::SubjectSeries(hr_values.size());
+  for (size_t j = 0; j < hr_values_diffs.size(); ++j) {
+    hr_values_diffs[j] = hr_values[j] - hr_avg;
+  }
+
+  return sqrtf(avx::dot_product(hr_values_diffs, hr_values_diffs));
+}
+
+/**
+ * Correlate the values of every period size from 1 to @param max_period_size and export them into a CSV file.
+ * All of the period sizes are derived from the same prefix sums, nothing is parsed or normalized again
+ *
+ * @param subject Index of the subject inside @code valid_subject_ids
+ * @param acc_pyramids Prefix sums of the X, Y and Z axes
+ * @param hr_pyramid Prefix sums of the HR values
+ * @param max_period_size The largest period size (in seconds)
+ */
+void sweep_period_sizes(
+    const size_t subject,
+    const std::vector<DataPreprocessing::PeriodPyramid>& acc_pyramids,
+    const DataPreprocessing::PeriodPyramid& hr_pyramid,
+    const uint8_t max_period_size) {
+  const std::string filename = OUT_FOLDER_PATH + "/patient_" +
+                               std::to_string(subject + 1) + "_periods.csv";
+  std::ofstream output(filename);
+  if (!output.is_open()) {
+    logger.log_error(errors::ERRORS::COULD_NOT_OPEN_FILE_HANDLE,
+                     "(Filename: " + filename + ")");
+    return;
+  }
+
+  output << "period_s,x,y,z\n";
+  for (uint16_t period_size = 1; period_size <= max_period_size;
+       ++period_size) {
+    DataPreprocessing::SubjectSeries hr_values =
+        hr_pyramid.derive((uint8_t)period_size, false);
+
+    std::vector<DataPreprocessing::SubjectSeries> acc_values;
+    for (const DataPreprocessing::PeriodPyramid& pyramid : acc_pyramids) {
+      acc_values.push_back(pyramid.derive((uint8_t)period_size, true));
+    }
+
+    const size_t common_length =
+        std::min(acc_values[0].size(), hr_values.size());
+    if (common_length < 2) {
+      break;  // Longer periods would not have enough values either
+    }
+
+    for (DataPreprocessing::SubjectSeries& axis : acc_values) {
+      axis.resize(common_length);
+    }
+    hr_values.resize(common_length);
+
+    DataPreprocessing::SubjectSeries hr_values_diffs;
+    const std::optional<float_t> hr_values_squared_root =
+        center_hr_values(hr_values, hr_values_diffs);
+    if (hr_values_squared_root == std::nullopt) {
+      break;
+    }
+
+    const std::optional<std::vector<float_t>> correlations =
+        avx::calculate_pearsons_correlations(
+            {acc_values[0], acc_values[1], acc_values[2]}, hr_values_diffs,
+            hr_values_squared_root.value());
+    if (correlations == std::nullopt) {
+      break;
+    }
+
+    const std::vector<float_t>& values = correlations.value();
+    logger.log_info("Period size " + std::to_string(period_size) +
+                    " s: correlations " + std::to_string(values[0]) + ", " +
+                    std::to_string(values[1]) + ", " +
+                    std::to_string(values[2]));
+    output << period_size << ',' << values[0] << ',' << values[1] << ','
+           << values[2] << '\n';
+  }
+
+  logger.log_info("Period size sweep exported into " + filename);
+}
+
+/**
+ * Preprocess the source files of a subject and search for its correlation formula
+ *
+ * @param subject Index of the subject inside @code valid_subject_ids
+ * @param run_options Options of the run (period size, rolling correlation windows)
+ * @param parse_threads Number of threads the ACC file is parsed with
+ * @param gpu OpenCL device shared by all of the subjects
+ * @param opencl_device Description of the OpenCL device
+ * @param gpu_mutex Mutex serializing the access to the OpenCL device
+ *
+ * @return true if the subject has been processed, false if its values could not have been preprocessed
+ */
+bool process_subject(const size_t subject,
+                     const options::RunOptions& run_options,
+                     const size_t parse_threads, const opencl::Gpu& gpu,
+                     const cl::Device& opencl_device, std::mutex& gpu_mutex) {
+  const uint8_t period_size = run_options.period_size;
+
+  // The files are always preprocessed with the base period and longer periods
+  // are derived from it. The start offset then does not depend on the period
+  // size, so a sweep and separate runs of any period size agree
+  const uint8_t preprocess_period = 1;
+
+  DataPreprocessing::SubjectDataProcessor data_processor(
+      valid_subject_ids[subject].first, valid_subject_ids[subject].second,
+      DataPreprocessing::INPUT_READER::MMAP, parse_threads);
+  const size_t NO_VALUES_ACC = 3;
+
+  std::pair<uint8_t, long long> timestamp_diff;
+  long long time_diff;
+
+  timestamp_diff = data_processor.validate_timestamps(preprocess_period);
+  if (timestamp_diff.first == RETURN_OK) {
+    time_diff = timestamp_diff.second;
+    logger.log_info("Timestamp difference calculated: " +
+                    std::to_string(time_diff));
+  } else {
+    logger.log_warning(warnings::WARNINGS::TIMESTAMP_CALCULATION_WARNING);
+  }
+
+  time_diff = timestamp_diff.first == RETURN_OK ? timestamp_diff.second : 0;
+  logger.log_debug("Timestamp diff: " + std::to_string(time_diff));
+
+  std::int8_t tmp_sign = time_diff > 0 ? 1 : -1;
+
+  std::optional tmp_acc = data_processor.preprocess_acc_file(
+      preprocess_period, time_diff > 0 ? time_diff * tmp_sign : 0);
+
+  std::optional tmp_hr = data_processor.preprocess_hr_file(
+      preprocess_period, time_diff < 0 ? time_diff * tmp_sign : 0);
+
+  if (tmp_acc == std::nullopt || tmp_hr == std::nullopt) {
+    logger.log_error(errors::ERRORS::COULD_NOT_PREPROCESS_VALUES);
+    return false;
+  }
+
+  // The subject's values are owned here from now on, never copied
+  DataPreprocessing::SubjectSeries hr_values = std::move(tmp_hr.value());
+  std::array<DataPreprocessing::SubjectSeries, NO_VALUES_ACC> acc_values =
+      std::move(tmp_acc.value());
+
+  if (run_options.sweep_max_period > 0 || period_size != preprocess_period) {
+    std::vector<DataPreprocessing::PeriodPyramid> acc_pyramids;
+    for (const DataPreprocessing::SubjectSeries& axis : acc_values) {
+      acc_pyramids.emplace_back(axis);
+    }
+    const DataPreprocessing::PeriodPyramid hr_pyramid(hr_values);
+
+    if (run_options.sweep_max_period > 0) {
+      sweep_period_sizes(subject, acc_pyramids, hr_pyramid,
+                         run_options.sweep_max_period);
+    }
+
+    // The rest of the run uses the selected period size
+    for (size_t j = 0; j < NO_VALUES_ACC; ++j) {
+      acc_values[j] = acc_pyramids[j].derive(period_size, true);
+    }
+    hr_values = hr_pyramid.derive(period_size, false);
+  }
+
+  // Both series begin at the same time, so they are matched by their true
+  // length. The reductions handle any length, no padding or synthetic samples
+  {
+    const size_t common_length =
+        std::min(acc_values[0].size(), hr_values.size());
+    if (acc_values[0].size() != hr_values.size()) {
+      logger.log_info("Truncating the ACC and HR values to the common length " +
+                      std::to_string(common_length) + " (ACC: " +
+                      std::to_string(acc_values[0].size()) +
+                      ", HR: " + std::to_string(hr_values.size()) + ")");
+    }
+
+    for (DataPreprocessing::SubjectSeries& axis : acc_values) {
+      axis.resize(common_length);
+    }
+    hr_values.resize(common_length);
+  }
+
+  // HR responds to movement with a delay - find it for every axis
+  if (run_options.max_lag_seconds > 0 && hr_values.size() > 2) {
+    const size_t max_lag = std::min(run_options.max_lag_seconds / period_size,
+                                    hr_values.size() - 2);
+
+    int64_t realign_lag = 0;
+    float_t strongest = -1.0f;
+    for (size_t j = 0; j < NO_VALUES_ACC; ++j) {
+      const std::optional<std::vector<float_t>> correlations =
+          fft::calculate_lag_correlations(acc_values[j], hr_values, max_lag);
+      if (correlations == std::nullopt) {
+        continue;
+      }
+
+      const int64_t lag = fft::best_lag(correlations.value());
+      const float_t correlation = correlations.value()[lag + max_lag];
+      logger.log_info("Best lag (axis " + std::to_string(j) + ") is " +
+                      std::to_string(lag * period_size) +
+                      " s with correlation " + std::to_string(correlation) +
+                      " (lag 0: " +
+                      std::to_string(correlations.value()[max_lag]) + ")");
+
+      if (std::fabs(correlation) > strongest) {
+        strongest = std::fabs(correlation);
+        realign_lag = lag;
+      }
+    }
+
+    // All of the axes share the HR values, so they are shifted by the lag of
+    // the most correlated axis
+    if (run_options.realign && realign_lag != 0) {
+      const size_t shift = (size_t)std::abs(realign_lag);
+      const size_t length = hr_values.size() - shift;
+
+      logger.log_info("Realigning the values by " +
+                      std::to_string(realign_lag * period_size) + " s");
+
+      const size_t acc_offset = realign_lag < 0 ? shift : 0;
+      const size_t hr_offset = realign_lag > 0 ? shift : 0;
+      for (DataPreprocessing::SubjectSeries& axis : acc_values) {
+        axis = DataPreprocessing::SubjectSeries::copy_of(
+            DataPreprocessing::SeriesView(axis).subview(acc_offset, length));
+      }
+      hr_values = DataPreprocessing::SubjectSeries::copy_of(
+          DataPreprocessing::SeriesView(hr_values).subview(hr_offset, length));
+    }
+  }
+
+  // Precalculate HR value statistics needed for the correlation calculation
+  // These need to be calculated just once, the will not change during the following computations
+  DataPreprocessing::SubjectSeries hr_values_diffs;
+  const std::optional<float_t> tmp =
+      center_hr_values(hr_values, hr_values_diffs);
+
+  if (tmp == std::nullopt) {
+    logger.log_error(errors::ERRORS::COULD_NOT_PREPROCESS_VALUES);
+    return false;
+  }
+
+  const float_t hr_values_squared_root = tmp.value();
+
+  // As an example, calculate the initial correlations on CPU using SIMD
+  // registers, since we need to calculate them just once. All of the axes are
+  // correlated in one pass over the HR values
+  const std::optional<std::vector<float_t>> initial_correlations =
+      avx::calculate_pearsons_correlations(
+          {acc_values[0], acc_values[1], acc_values[2]}, hr_values_diffs,
+          hr_values_squared_root);
+
+  std::optional<std::vector<float_t>> rank_correlations;
+  if (run_options.spearman) {
+    rank_correlations = avx::calculate_spearmans_correlations(
+        {acc_values[0], acc_values[1], acc_values[2]}, hr_values);
+  }
+
+  // Correlation over time - one value per window of every axis
+  if (run_options.window_seconds > 0) {
+    const size_t window = run_options.window_seconds / period_size;
+    const size_t step =
+        std::max<size_t>(1, run_options.step_seconds / period_size);
+
+    std::array<std::vector<float_t>, NO_VALUES_ACC> rolling;
+    bool computed = true;
+    for (size_t j = 0; j < NO_VALUES_ACC && computed; ++j) {
+      std::optional tmp = avx::calculate_rolling_correlations(
+          acc_values[j], hr_values, window, step);
+      computed = tmp != std::nullopt;
+      if (computed) {
+        rolling[j] = std::move(tmp.value());
+      }
+    }
+
+    const std::string filename = OUT_FOLDER_PATH + "/patient_" +
+                                 std::to_string(subject + 1) + "_rolling.csv";
+    if (computed &&
+        export_rolling_correlations(filename, step * period_size, rolling)) {
+      logger.log_info("Rolling correlations of " +
+                      std::to_string(rolling[0].size()) +
+                      " windows exported into " + filename);
+    }
+  }
+
+  for (size_t j = 0; j < NO_VALUES_ACC; ++j) {
+    const DataPreprocessing::SeriesView curr_acc_values = acc_values[j];
+    if (initial_correlations != std::nullopt) {
+      logger.log_info("Initial correlation (axis " + std::to_string(j) +
+                      ") is " +
+                      std::to_string(initial_correlations.value()[j]));
+    }
+    if (rank_correlations != std::nullopt) {
+      logger.log_info("Spearman's rank correlation (axis " +
+                      std::to_string(j) + ") is " +
+                      std::to_string(rank_correlations.value()[j]));
+    }
+
+    auto desc = opencl_device.getInfo<CL_DEVICE_NAME>();
+    logger.log_info("Starting correlation formula generation on device: " +
+                    desc);
+
+    std::pair<DataPreprocessing::SubjectSeries, std::vector<float_t>> best_fit;
+    {
+      // Only the device is shared, everything else runs in parallel
+      std::lock_guard<std::mutex> gpu_lock(gpu_mutex);
+      best_fit = gpu.compute_correlation_formula(
+          curr_acc_values, hr_values_diffs, hr_values_squared_root);
+    }
+
+    std::string tree_string;
+    tree_string.reserve(GENERATION_INDIVIDUAL_SIZE *
+                        20);  // 20 chars per node should be enough
+
+    // Convert the syntax tree to a string
+    for (size_t k = 0; k < GENERATION_INDIVIDUAL_SIZE;
+         k += GENERATION_TREE_NODE_SIZE) {
+      std::string op = "?";
+
+      tree_string.append(" + (");
+
+      float_t curr = best_fit.second[k + 1];
+      if (curr == X_FLOAT_REPRESENTATION) {
+        tree_string.append("x ");
+      } else {
+        tree_string.append(std::to_string(curr) + " ");
+      }
+
+      curr = best_fit.second[k];
+      if (curr == ADD_FLOAT_REPRESENTATION) {
+        op = "+";
+      } else if (curr == SUB_FLOAT_REPRESENTATION) {
+        op = "-";
+      } else if (curr == MUL_FLOAT_REPRESENTATION) {
+        op = "*";
+      } else if (curr == DIV_FLOAT_REPRESENTATION) {
+        op = "/";
+      }
+
+      tree_string.append(op + " " + std::to_string(best_fit.second[k + 2]) +
+                         ")");
+    }
+
+    logger.log_info("Tree corresponding to the calculated correlation: " +
+                    tree_string);
+
+    // Plot the values
+    std::string axis = "";
+    switch (j) {
+      case 0:
+        axis = "X";
+        break;
+      case 1:
+        axis = "Y";
+        break;
+      case 2:
+        axis = "Z";
+        break;
+      default:
+        axis = "unknown";
+    }
+    std::string filename = OUT_FOLDER_PATH + "/patient_" +
+                           std::to_string(subject + 1) + "_axis_" + axis + "_" +
+                           opencl_device.getInfo<CL_DEVICE_NAME>() + ".svg";
+    logger.log_info("Exporting results into " + filename);
+    svg::plot_correlation_values(filename, best_fit.first, hr_values,
+                                 tree_string);
+    logger.log_info("Results exported");
+  }
+
+  return true;
+}
+
 int main(int argc, char* argv[]) {
   std::cout << "\n-------------------------" << std::endl;
   std::cout << "Welcome to the PPR Correlation Finder" << std::endl;
@@ -113,24 +559,32 @@ int main(int argc, char* argv[]) {
 
   Logging::APP_LOGGING_LEVEL = Logging::LOG_LEVEL::INFO;
 
-  uint8_t period_size = 1;
-  if (argc > 1) {
-    try {
-      period_size = std::stoi(argv[1]);
-      if (period_size > MAX_SUPPORTED_PERIOD_SIZE || period_size < 1) {
-        logger.log_warning(warnings::WARNINGS::INVALID_PERIOD_SIZE,
-                           "Falling back to the default period size (=1)");
-        period_size = 1;
-      }
-    } catch (const std::invalid_argument& err) {
-      logger.log_warning(warnings::WARNINGS::COULD_NOT_PARSE_CMD_ARGS,
-                         "(" + (std::string)argv[1] +
-                             "). The period size will fall back to \"1\"");
-      period_size = 1;
+  const options::RunOptions run_options =
+      options::parse_run_options(argc, argv);
+
+  avx::set_summation(run_options.summation);
+
+  if (run_options.sum_benchmark) {
+    benchmark::run_summation_benchmark();
+    return EXIT_SUCCESS;
+  }
+
+  if (run_options.benchmark) {
+    if (validate_resources() != RETURN_OK || valid_subject_ids.empty()) {
+      return EXIT_FAILURE;
     }
+
+    benchmark::run_parse_benchmark(valid_subject_ids[0].first,
+                                   valid_subject_ids[0].second);
+    return EXIT_SUCCESS;
   }
 
+  const uint8_t period_size = run_options.period_size;
+
   logger.log_info("Period size: " + std::to_string(period_size));
+  logger.log_info("CPU kernels use " +
+                  avx::simd_level_name(avx::simd_level()) + " instructions");
+  logger.log_info("Summation: " + avx::summation_name(avx::summation()));
 
   logger.log_info("Validating resource files...");
   int8_t rv = validate_resources();
@@ -186,169 +640,59 @@ int main(int argc, char* argv[]) {
 
   logger.log_info("Beginning data preprocessing...");
 
-  for (size_t i = 0; i < valid_subject_ids.size(); ++i) {
-
-    DataPreprocessing::SubjectDataProcessor data_processor(
-        valid_subject_ids[i].first, valid_subject_ids[i].second);
-    const size_t NO_VALUES_ACC = 3;
-
-    std::array<std::vector<float_t>, NO_VALUES_ACC> acc_values;
-    std::vector<float_t> hr_values;
-    std::pair<uint8_t, long long> timestamp_diff;
-    long long time_diff;
-
-    timestamp_diff = data_processor.validate_timestamps(period_size);
-    if (timestamp_diff.first == RETURN_OK) {
-      time_diff = timestamp_diff.second;
-      logger.log_info("Timestamp difference calculated: " +
-                      std::to_string(time_diff));
-    } else {
-      logger.log_warning(warnings::WARNINGS::TIMESTAMP_CALCULATION_WARNING);
-    }
-
-    time_diff = timestamp_diff.first == RETURN_OK ? timestamp_diff.second : 0;
-    logger.log_debug("Timestamp diff: " + std::to_string(time_diff));
-
-    std::int8_t tmp_sign = time_diff > 0 ? 1 : -1;
-
-    std::optional tmp_acc = data_processor.preprocess_acc_file(
-        period_size, time_diff > 0 ? time_diff * tmp_sign : 0);
-
-    std::optional tmp_hr = data_processor.preprocess_hr_file(
-        period_size, time_diff < 0 ? time_diff * tmp_sign : 0);
-
-    if (tmp_acc == std::nullopt || tmp_hr == std::nullopt) {
-      logger.log_error(errors::ERRORS::COULD_NOT_PREPROCESS_VALUES);
-      return EXIT_FAILURE;
-    }
-
-    hr_values = tmp_hr.value();
-    acc_values = tmp_acc.value();
-
-    // Linear interpolation + AVX2 proper padding
-    {
-      int64_t len_diff = acc_values[0].size() - hr_values.size();
-      size_t padding = 0;
-      if (len_diff < 0) {
-        len_diff = std::abs(len_diff);
-
-        for (size_t j = 0; j < acc_values.size(); ++j) {
-          padding = data_processor.interpolate_vector_linear(
-              acc_values[j], len_diff + padding);
-        }
-
-        data_processor.interpolate_vector_linear(hr_values, padding);
-      } else if (len_diff > 0) {
-        padding = data_processor.interpolate_vector_linear(hr_values, len_diff);
-
-        for (size_t j = 0; j < acc_values.size(); ++j) {
-          data_processor.interpolate_vector_linear(acc_values[j], padding);
-        }
+  // Subjects are independent, so several of them may be processed at once
+  const size_t jobs = std::max<size_t>(
+      1, std::min(run_options.jobs, valid_subject_ids.size()));
+
+  // A single ACC file is parsed on the cores left to its subject
+  const size_t parse_threads = std::max<size_t>(
+      1, std::min<size_t>(std::thread::hardware_concurrency() / jobs,
+                          MAX_PARSE_THREADS));
+
+  // Reads the next subjects' files while the current ones are being computed
+  DataPreprocessing::SubjectPrefetcher prefetcher(valid_subject_ids,
+                                                  run_options.prefetch_depth);
+
+  DataPreprocessing::MemoryBudget memory_budget(run_options.memory_budget_mb *
+                                                1024 * 1024);
+  std::mutex gpu_mutex;
+  std::atomic<size_t> next_subject{0};
+  std::atomic<bool> failed{false};
+
+  const auto process_subjects = [&]() {
+    for (size_t i = next_subject++; i < valid_subject_ids.size() && !failed;
+         i = next_subject++) {
+      const size_t memory =
+          DataPreprocessing::MemoryBudget::estimate_subject_memory(
+              valid_subject_ids[i].first, valid_subject_ids[i].second);
+
+      memory_budget.acquire(memory);
+      prefetcher.begin_subject(i);
+
+      if (!process_subject(i, run_options, parse_threads, gpu, opencl_device,
+                           gpu_mutex)) {
+        failed = true;  // Subjects that have already started are finished
       }
-    }
 
-    const std::optional<float_t> tmp = avx::vector_sum_avx2(hr_values);
-
-    if (tmp == std::nullopt) {
-      logger.log_error(errors::ERRORS::COULD_NOT_PREPROCESS_VALUES);
-      return EXIT_FAILURE;
+      memory_budget.release(memory);
     }
+  };
 
-    const float_t hr_avg = tmp.value() / hr_values.size();
+  if (jobs > 1) {
+    logger.log_info("Processing " + std::to_string(jobs) +
+                    " subjects in parallel");
 
-    // Precalculate HR value statistics needed for the correlation calculation
-    // These need to be calculated just once, the will not change during the following computations
-    std::vector<float_t> hr_values_diffs = hr_values;
-    std::float_t hr_values_squared_diffs = 0.0;
-    for (size_t j = 0; j < hr_values_diffs.size(); ++j) {
-      hr_values_diffs[j] -= hr_avg;
-      hr_values_squared_diffs += hr_values_diffs[j] * hr_values_diffs[j];
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < jobs; ++i) {
+      workers.emplace_back(process_subjects);
     }
 
-    const float_t hr_values_squared_root = sqrtf(hr_values_squared_diffs);
-
-    float_t initial_correlation = 0.0f;
-    std::vector<float_t> result(0.0, acc_values.size());
-    cl::Buffer acc_buffer, hr_buffer, result_buffer;
-    cl::Context current_context;
-
-    for (size_t j = 0; j < NO_VALUES_ACC; ++j) {
-      std::vector<float_t> curr_acc_values = acc_values[j];
-      // As an example, calculate the initial correlation on CPU using AVX2 registers, since we need to calculate it just once
-      std::optional tmp = avx::calculate_pearsons_correlation(
-          curr_acc_values, hr_values_diffs, hr_values_squared_root);
-      if (tmp != std::nullopt) {
-        initial_correlation = tmp.value();
-        logger.log_info("Initial correlation (axis " + std::to_string(j) +
-                        ") is " + std::to_string(initial_correlation));
-      }
-
-      auto desc = opencl_device.getInfo<CL_DEVICE_NAME>();
-      logger.log_info("Starting correlation formula generation on device: " +
-                      desc);
-
-      std::pair<std::vector<float_t>, std::vector<float_t>> best_fit =
-          gpu.compute_correlation_formula(curr_acc_values, hr_values_diffs,
-                                          hr_values_squared_root);
-
-      std::string tree_string;
-      tree_string.reserve(GENERATION_INDIVIDUAL_SIZE *
-                          20);  // 20 chars per node should be enough
-
-      // Convert the syntax tree to a string
-      for (size_t k = 0; k < GENERATION_INDIVIDUAL_SIZE;
-           k += GENERATION_TREE_NODE_SIZE) {
-        std::string op = "?";
-
-        tree_string.append(" + (");
-
-        float_t curr = best_fit.second[k + 1];
-        if (curr == X_FLOAT_REPRESENTATION) {
-          tree_string.append("x ");
-        } else {
-          tree_string.append(std::to_string(curr) + " ");
-        }
-
-        curr = best_fit.second[k];
-        if (curr == ADD_FLOAT_REPRESENTATION) {
-          op = "+";
-        } else if (curr == SUB_FLOAT_REPRESENTATION) {
-          op = "-";
-        } else if (curr == MUL_FLOAT_REPRESENTATION) {
-          op = "*";
-        } else if (curr == DIV_FLOAT_REPRESENTATION) {
-          op = "/";
-        }
-
-        tree_string.append(op + " " + std::to_string(best_fit.second[k + 2]) +
-                           ")");
-      }
-
-      logger.log_info("Tree corresponding to the calculated correlation: " +
-                      tree_string);
-
-      // Plot the values
-      std::string axis = "";
-      switch (j) {
-        case 0:
-          axis = "X";
-          break;
-        case 1:
-          axis = "Y";
-          break;
-        case 2:
-          axis = "Z";
-          break;
-        default:
-          axis = "unknown";
-      }
-      std::string filename = OUT_FOLDER_PATH + "/patient_" +
-                             std::to_string(i + 1) + "_axis_" + axis + "_" +
-                             opencl_device.getInfo<CL_DEVICE_NAME>() + ".svg";
-      logger.log_info("Exporting results into " + filename);
-      svg::plot_correlation_values(filename, best_fit.first, hr_values,
-                                   tree_string);
-      logger.log_info("Results exported");
+    for (std::thread& worker : workers) {
+      worker.join();
     }
+  } else {
+    process_subjects();
   }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
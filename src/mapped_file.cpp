@@ -0,0 +1,78 @@
+#include "include/mapped_file.hpp"
+#include <utility>
+
+#if !defined(WIN32) && !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace DataPreprocessing {
+
+MappedFile::MappedFile(const std::string& file_path) noexcept
+    : _file_path(file_path) {
+#if !defined(WIN32) && !defined(_WIN32)
+  int fd = ::open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+
+  struct stat file_stat {};
+  if (::fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    ::close(fd);
+    return;
+  }
+
+  void* data = ::mmap(nullptr, (size_t)file_stat.st_size, PROT_READ,
+                      MAP_PRIVATE, fd, 0);
+  ::close(fd);  // The mapping stays valid after the descriptor is closed
+
+  if (data == MAP_FAILED) {
+    return;
+  }
+
+  // The file is read front to back exactly once
+  ::madvise(data, (size_t)file_stat.st_size, MADV_SEQUENTIAL);
+
+  _data = static_cast<const char*>(data);
+  _size = (size_t)file_stat.st_size;
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : _file_path(std::move(other._file_path)),
+      _data(other._data),
+      _size(other._size) {
+  other._data = nullptr;
+  other._size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    unmap();
+    _file_path = std::move(other._file_path);
+    _data = other._data;
+    _size = other._size;
+    other._data = nullptr;
+    other._size = 0;
+  }
+
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  unmap();
+}
+
+void MappedFile::unmap() noexcept {
+#if !defined(WIN32) && !defined(_WIN32)
+  if (_data != nullptr) {
+    ::munmap(const_cast<char*>(_data), _size);
+  }
+#endif
+  _data = nullptr;
+  _size = 0;
+}
+
+}  // namespace DataPreprocessing
@@ -0,0 +1,49 @@
+#include "include/memory_budget.hpp"
+#include <filesystem>
+#include "include/decompressor.hpp"
+
+namespace DataPreprocessing {
+
+MemoryBudget::MemoryBudget(const size_t budget) noexcept : _budget(budget) {}
+
+void MemoryBudget::acquire(const size_t bytes) noexcept {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _released.wait(lock, [this, bytes] {
+    return _budget == 0 || _holders == 0 || _used + bytes <= _budget;
+  });
+
+  _used += bytes;
+  ++_holders;
+}
+
+void MemoryBudget::release(const size_t bytes) noexcept {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _used -= bytes;
+    --_holders;
+  }
+  _released.notify_all();
+}
+
+size_t MemoryBudget::estimate_subject_memory(
+    const std::string& acc_file_path,
+    const std::string& hr_file_path) noexcept {
+  size_t bytes = 0;
+
+  for (const std::string& file_path : {acc_file_path, hr_file_path}) {
+    std::error_code err{};
+    const uintmax_t size = std::filesystem::file_size(file_path, err);
+    if (err) {
+      continue;
+    }
+
+    bytes += StreamingDecompressor::compression_of(file_path) ==
+                     COMPRESSION::NONE
+                 ? (size_t)size
+                 : (size_t)size * COMPRESSED_MEMORY_FACTOR;
+  }
+
+  return bytes;
+}
+
+}  // namespace DataPreprocessing
@@ -0,0 +1,127 @@
+#include "include/options.hpp"
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include "include/constants.hpp"
+#include "include/logger.hpp"
+#include "include/warnings.hpp"
+
+namespace options {
+
+Logging::Logger& logger = Logging::Logger::get_instance();
+
+/**
+ * Parse an unsigned integer value of a named argument
+ *
+ * @param argument Whole argument (used in the warning)
+ * @param value Value part of the argument
+ *
+ * @return Parsed value, std::nullopt if it is not a valid unsigned integer
+ */
+static std::optional<size_t> parse_size_value(const std::string& argument,
+                                              const std::string& value) {
+  size_t parsed = 0;
+  const std::from_chars_result result =
+      std::from_chars(value.data(), value.data() + value.size(), parsed);
+  if (value.empty() || result.ec != std::errc() ||
+      result.ptr != value.data() + value.size()) {
+    logger.log_warning(warnings::WARNINGS::COULD_NOT_PARSE_CMD_ARGS,
+                       "(" + argument + "). The default will be used");
+    return std::nullopt;
+  }
+
+  return parsed;
+}
+
+RunOptions parse_run_options(const int argc, char* argv[]) noexcept {
+  RunOptions options;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument = argv[i];
+
+    if (argument == BENCHMARK_ARG) {
+      options.benchmark = true;
+      continue;
+    }
+
+    if (argument == SUM_BENCHMARK_ARG) {
+      options.sum_benchmark = true;
+      continue;
+    }
+
+    if (argument == SPEARMAN_ARG) {
+      options.spearman = true;
+      continue;
+    }
+
+    if (argument == REALIGN_ARG) {
+      options.realign = true;
+      continue;
+    }
+
+    if (argument.rfind("--", 0) == 0) {
+      const size_t separator = argument.find('=');
+      const std::string name = argument.substr(0, separator);
+      const std::string value =
+          separator == std::string::npos ? "" : argument.substr(separator + 1);
+
+      if (name == PREFETCH_ARG) {
+        const std::optional<size_t> parsed = parse_size_value(argument, value);
+        options.prefetch_depth = parsed.value_or(options.prefetch_depth);
+      } else if (name == JOBS_ARG) {
+        const std::optional<size_t> parsed = parse_size_value(argument, value);
+        options.jobs = std::max<size_t>(1, parsed.value_or(options.jobs));
+      } else if (name == MEMORY_BUDGET_ARG) {
+        const std::optional<size_t> parsed = parse_size_value(argument, value);
+        options.memory_budget_mb = parsed.value_or(options.memory_budget_mb);
+      } else if (name == WINDOW_ARG) {
+        const std::optional<size_t> parsed = parse_size_value(argument, value);
+        options.window_seconds = parsed.value_or(options.window_seconds);
+      } else if (name == MAX_LAG_ARG) {
+        const std::optional<size_t> parsed = parse_size_value(argument, value);
+        options.max_lag_seconds = parsed.value_or(options.max_lag_seconds);
+      } else if (name == SWEEP_ARG) {
+        const std::optional<size_t> parsed = parse_size_value(argument, value);
+        options.sweep_max_period = (uint8_t)std::min<size_t>(
+            parsed.value_or(options.sweep_max_period),
+            MAX_SUPPORTED_PERIOD_SIZE);
+      } else if (name == SUMMATION_ARG) {
+        const std::optional<avx::SUMMATION> parsed =
+            avx::parse_summation(value);
+        if (parsed == std::nullopt) {
+          logger.log_warning(warnings::WARNINGS::COULD_NOT_PARSE_CMD_ARGS,
+                             "(" + argument + "). The default will be used");
+        }
+        options.summation = parsed.value_or(options.summation);
+      } else if (name == STEP_ARG) {
+        const std::optional<size_t> parsed = parse_size_value(argument, value);
+        options.step_seconds =
+            std::max<size_t>(1, parsed.value_or(options.step_seconds));
+      } else {
+        logger.log_warning(warnings::WARNINGS::COULD_NOT_PARSE_CMD_ARGS,
+                           "(Unknown argument " + argument + ")");
+      }
+      continue;
+    }
+
+    // Positional argument - the period size
+    try {
+      const int period_size = std::stoi(argument);
+      if (period_size > MAX_SUPPORTED_PERIOD_SIZE || period_size < 1) {
+        logger.log_warning(warnings::WARNINGS::INVALID_PERIOD_SIZE,
+                           "Falling back to the default period size (=1)");
+        options.period_size = 1;
+      } else {
+        options.period_size = (uint8_t)period_size;
+      }
+    } catch (const std::exception&) {
+      logger.log_warning(warnings::WARNINGS::COULD_NOT_PARSE_CMD_ARGS,
+                         "(" + argument +
+                             "). The period size will fall back to \"1\"");
+      options.period_size = 1;
+    }
+  }
+
+  return options;
+}
+}  // namespace options
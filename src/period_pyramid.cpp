@@ -0,0 +1,38 @@
+#include "include/period_pyramid.hpp"
+#include <algorithm>
+
+namespace DataPreprocessing {
+
+PeriodPyramid::PeriodPyramid(const SeriesView values)
+    : _prefix_sums(values.size() + 1, 0.0) {
+  for (size_t i = 0; i < values.size(); ++i) {
+    _prefix_sums[i + 1] = _prefix_sums[i] + values[i];
+  }
+}
+
+SubjectSeries PeriodPyramid::derive(const uint8_t period_size,
+                                    const bool keep_incomplete) const {
+  if (period_size == 0) {
+    return SubjectSeries();
+  }
+
+  const size_t count = size();
+  const size_t periods = keep_incomplete
+                             ? (count + period_size - 1) / period_size
+                             : count / period_size;
+
+  SubjectSeries derived(periods);
+  for (size_t i = 0; i < periods; ++i) {
+    const size_t begin = i * period_size;
+    const size_t end = std::min(begin + period_size, count);
+
+    // Incomplete periods are divided by the full period size as well, the
+    // same way as the normalization does
+    derived[i] =
+        (float_t)((_prefix_sums[end] - _prefix_sums[begin]) / period_size);
+  }
+
+  return derived;
+}
+
+}  // namespace DataPreprocessing
@@ -0,0 +1,121 @@
+#include "include/prefetcher.hpp"
+#include <filesystem>
+#include "include/logger.hpp"
+#include "include/subject_cache.hpp"
+
+#if !defined(WIN32) && !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace DataPreprocessing {
+
+SubjectPrefetcher::SubjectPrefetcher(
+    const std::vector<std::pair<std::string, std::string>>& subjects,
+    const size_t look_ahead)
+    : _subjects(subjects), _look_ahead(look_ahead) {
+  if (_look_ahead > 0 && !_subjects.empty()) {
+    _worker = std::thread(&SubjectPrefetcher::run, this);
+  }
+}
+
+SubjectPrefetcher::~SubjectPrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _condition.notify_one();
+
+  if (_worker.joinable()) {
+    _worker.join();
+  }
+}
+
+void SubjectPrefetcher::begin_subject(const size_t subject) noexcept {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _requested = std::min(_subjects.size(),
+                          std::max(_requested, subject + 1 + _look_ahead));
+    _prefetched = std::max(_prefetched, subject + 1);  // Too late for these
+  }
+  _condition.notify_one();
+}
+
+void SubjectPrefetcher::run() noexcept {
+  while (true) {
+    size_t subject = 0;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _condition.wait(lock,
+                      [this] { return _stop || _prefetched < _requested; });
+      if (_stop) {
+        return;
+      }
+
+      subject = _prefetched++;
+    }
+
+    const size_t bytes = prefetch_file(_subjects[subject].first) +
+                         prefetch_file(_subjects[subject].second);
+
+    Logging::Logger::get_instance().log_debug(
+        "Prefetched " + std::to_string(bytes) + " bytes of subject " +
+        std::to_string(subject + 1));
+  }
+}
+
+size_t SubjectPrefetcher::prefetch_file(
+    const std::string& file_path) const noexcept {
+#if !defined(WIN32) && !defined(_WIN32)
+  // A valid cache is what is going to be read
+  std::error_code err{};
+  const std::string cache_path = SubjectCache::cache_path(file_path);
+  const std::string& path =
+      std::filesystem::exists(cache_path, err) ? cache_path : file_path;
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+
+  struct stat file_stat {};
+  if (::fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    ::close(fd);
+    return 0;
+  }
+  const size_t size = (size_t)file_stat.st_size;
+
+  // Asynchronous read-ahead by the kernel (not available on macOS, madvise
+  // below covers it there)
+#ifdef POSIX_FADV_WILLNEED
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return 0;
+  }
+
+  ::madvise(data, size, MADV_WILLNEED);
+
+  // Touch every page, so that the file is surely in the page cache once this returns
+  const size_t page_size = (size_t)::sysconf(_SC_PAGESIZE);
+  const volatile char* bytes = static_cast<const volatile char*>(data);
+  size_t touched = 0;
+  for (; touched < size && !_stop; touched += page_size) {
+    (void)bytes[touched];
+  }
+
+  ::munmap(data, size);
+
+  return std::min(touched, size);
+#else
+  (void)file_path;
+  return 0;
+#endif
+}
+
+}  // namespace DataPreprocessing
@@ -0,0 +1,120 @@
+#include "include/ranks.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <execution>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace DataPreprocessing {
+
+/** Number of buckets of one counting sort pass */
+constexpr size_t RANK_BUCKETS = 1 << RANK_RADIX_BITS;
+
+uint32_t rank_key(const float_t value) noexcept {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  if (value == 0.0f) {  // -0 and +0 are tied
+    bits = 0;
+  }
+
+  return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+SubjectSeries rank_values(const SeriesView values) {
+  const size_t count = values.size();
+  SubjectSeries ranks(count);
+  if (count == 0) {
+    return ranks;
+  }
+
+  std::vector<uint32_t> keys(count), sorted_keys(count);
+  std::vector<uint32_t> order(count), sorted_order(count);
+  std::transform(std::execution::par, values.begin(), values.end(),
+                 keys.begin(), rank_key);
+  std::iota(order.begin(), order.end(), 0);
+
+  // Every chunk is counted and scattered by one worker. The chunks are
+  // scattered into disjoint ranges in their original order, so every pass is
+  // stable, as LSD radix sort requires
+  const size_t workers =
+      std::max<size_t>(1, std::thread::hardware_concurrency());
+  const size_t chunks_count = std::max<size_t>(
+      1, std::min(workers, count / RANK_MIN_CHUNK_SIZE));
+  const size_t chunk_size = (count + chunks_count - 1) / chunks_count;
+
+  std::vector<size_t> chunk_ids(chunks_count);
+  std::iota(chunk_ids.begin(), chunk_ids.end(), 0);
+  std::vector<std::array<size_t, RANK_BUCKETS>> histograms(chunks_count);
+
+  for (size_t shift = 0; shift < 32; shift += RANK_RADIX_BITS) {
+    std::for_each(std::execution::par, chunk_ids.begin(), chunk_ids.end(),
+                  [&](const size_t chunk) {
+                    std::array<size_t, RANK_BUCKETS>& histogram =
+                        histograms[chunk];
+                    histogram.fill(0);
+
+                    const size_t end =
+                        std::min(count, (chunk + 1) * chunk_size);
+                    for (size_t i = chunk * chunk_size; i < end; ++i) {
+                      ++histogram[(keys[i] >> shift) & (RANK_BUCKETS - 1)];
+                    }
+                  });
+
+    // Bucket-major exclusive scan - the offset of every chunk in every bucket
+    size_t offset = 0;
+    bool single_bucket = false;
+    for (size_t bucket = 0; bucket < RANK_BUCKETS; ++bucket) {
+      const size_t bucket_begin = offset;
+      for (std::array<size_t, RANK_BUCKETS>& histogram : histograms) {
+        const size_t chunk_count = histogram[bucket];
+        histogram[bucket] = offset;
+        offset += chunk_count;
+      }
+      single_bucket |= offset - bucket_begin == count;
+    }
+
+    // The digit is the same for all of the keys, the pass would not move them
+    if (single_bucket) {
+      continue;
+    }
+
+    std::for_each(std::execution::par, chunk_ids.begin(), chunk_ids.end(),
+                  [&](const size_t chunk) {
+                    std::array<size_t, RANK_BUCKETS>& offsets =
+                        histograms[chunk];
+
+                    const size_t end =
+                        std::min(count, (chunk + 1) * chunk_size);
+                    for (size_t i = chunk * chunk_size; i < end; ++i) {
+                      const size_t position =
+                          offsets[(keys[i] >> shift) & (RANK_BUCKETS - 1)]++;
+                      sorted_keys[position] = keys[i];
+                      sorted_order[position] = order[i];
+                    }
+                  });
+
+    keys.swap(sorted_keys);
+    order.swap(sorted_order);
+  }
+
+  // Tied values are neighbours in the sorted order, they share their average
+  // rank
+  for (size_t first = 0; first < count;) {
+    size_t last = first + 1;
+    while (last < count && keys[last] == keys[first]) {
+      ++last;
+    }
+
+    const float_t rank = (float_t)(first + last + 1) / 2.0f;
+    for (size_t i = first; i < last; ++i) {
+      ranks[order[i]] = rank;
+    }
+    first = last;
+  }
+
+  return ranks;
+}
+}  // namespace DataPreprocessing
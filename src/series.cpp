@@ -0,0 +1,81 @@
+#include "include/series.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace DataPreprocessing {
+
+float_t* SubjectSeries::allocate(const size_t count) {
+  if (count == 0) {
+    return nullptr;
+  }
+
+  // std::aligned_alloc requires the size to be a multiple of the alignment
+  size_t bytes = count * sizeof(float_t);
+  bytes = (bytes + SERIES_ALIGNMENT - 1) / SERIES_ALIGNMENT * SERIES_ALIGNMENT;
+
+  void* data = std::aligned_alloc(SERIES_ALIGNMENT, bytes);
+  if (data == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return static_cast<float_t*>(data);
+}
+
+SubjectSeries::SubjectSeries(const size_t size, const float_t value)
+    : _data(allocate(size)), _size(size), _capacity(size) {
+  std::fill(begin(), end(), value);
+}
+
+SubjectSeries::SubjectSeries(SubjectSeries&& other) noexcept
+    : _data(other._data), _size(other._size), _capacity(other._capacity) {
+  other._data = nullptr;
+  other._size = 0;
+  other._capacity = 0;
+}
+
+SubjectSeries& SubjectSeries::operator=(SubjectSeries&& other) noexcept {
+  if (this != &other) {
+    std::free(_data);
+    _data = other._data;
+    _size = other._size;
+    _capacity = other._capacity;
+    other._data = nullptr;
+    other._size = 0;
+    other._capacity = 0;
+  }
+
+  return *this;
+}
+
+SubjectSeries::~SubjectSeries() {
+  std::free(_data);
+}
+
+SubjectSeries SubjectSeries::copy_of(const SeriesView& values) {
+  SubjectSeries series;
+  series._data = allocate(values.size());
+  series._size = values.size();
+  series._capacity = values.size();
+  std::copy(values.begin(), values.end(), series.begin());
+
+  return series;
+}
+
+void SubjectSeries::resize(const size_t size) {
+  if (size > _capacity) {
+    float_t* data = allocate(size);
+    std::copy(begin(), end(), data);
+    std::free(_data);
+    _data = data;
+    _capacity = size;
+  }
+
+  if (size > _size) {
+    std::fill(_data + _size, _data + size, 0.0f);
+  }
+
+  _size = size;
+}
+
+}  // namespace DataPreprocessing
@@ -0,0 +1,209 @@
+#include "include/subject_cache.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "include/constants.hpp"
+#include "include/logger.hpp"
+
+#if defined(WIN32) || defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace DataPreprocessing {
+
+/** Last modification time of a file, 0 if it could not have been read */
+static int64_t file_mtime(const std::string& file_path) noexcept {
+  std::error_code err{};
+  const auto mtime = std::filesystem::last_write_time(file_path, err);
+  return err ? 0 : (int64_t)mtime.time_since_epoch().count();
+}
+
+SubjectCache::SubjectCache(const std::string& source_path,
+                           const uint32_t columns) noexcept
+    : _file(cache_path(source_path)) {
+  if (!_file.is_mapped() || _file.size() < sizeof(SubjectCacheHeader)) {
+    return;
+  }
+
+  const SubjectCacheHeader* header =
+      reinterpret_cast<const SubjectCacheHeader*>(_file.begin());
+
+  if (std::memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      header->version != CACHE_VERSION || header->columns != columns ||
+      _file.size() != sizeof(SubjectCacheHeader) + header->count * columns) {
+    return;
+  }
+
+  std::error_code err{};
+  const uintmax_t source_size = std::filesystem::file_size(source_path, err);
+  if (err || source_size != header->source_size) {
+    return;
+  }
+
+  // Touched, but not necessarily modified
+  if (file_mtime(source_path) != header->source_mtime) {
+    const MappedFile source(source_path);
+    if (!source.is_mapped() ||
+        checksum(source.begin(), source.end()) != header->source_checksum) {
+      return;
+    }
+  }
+
+  _header = header;
+}
+
+std::vector<float_t> SubjectCache::column_values(
+    const size_t column, const size_t offset) const noexcept {
+  if (!is_valid() || column >= _header->columns ||
+      offset >= _header->count) {
+    return std::vector<float_t>();
+  }
+
+  const char* begin = column_data(column);
+  const char* end = begin + _header->count;
+  begin += offset;
+
+  std::vector<float_t> values(end - begin);
+  if (_header->is_signed) {
+    const int8_t* data = reinterpret_cast<const int8_t*>(begin);
+    std::copy(data, data + values.size(), values.begin());
+  } else {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(begin);
+    std::copy(data, data + values.size(), values.begin());
+  }
+
+  return values;
+}
+
+std::string SubjectCache::cache_path(const std::string& source_path) noexcept {
+  return std::filesystem::path(source_path)
+      .replace_extension(CACHE_FILE_FORMAT)
+      .string();
+}
+
+uint64_t SubjectCache::checksum(const char* begin, const char* end) noexcept {
+  const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+  const uint64_t FNV_PRIME = 1099511628211ULL;
+
+  uint64_t hash = FNV_OFFSET_BASIS;
+  uint64_t word = 0;
+
+  for (; begin + sizeof(word) <= end; begin += sizeof(word)) {
+    std::memcpy(&word, begin, sizeof(word));
+    hash = (hash ^ word) * FNV_PRIME;
+  }
+
+  for (; begin < end; ++begin) {
+    hash = (hash ^ (uint8_t)*begin) * FNV_PRIME;
+  }
+
+  return hash;
+}
+
+bool SubjectCache::write(
+    const std::string& source_path, const int64_t start_epoch,
+    const uint32_t sample_freq,
+    const std::vector<const std::vector<float_t>*>& columns,
+    const bool is_signed) noexcept {
+  Logging::Logger& logger = Logging::Logger::get_instance();
+
+  if (columns.empty()) {
+    return false;
+  }
+
+  const size_t count = columns[0]->size();
+  const float_t min_value = is_signed ? INT8_MIN : 0;
+  const float_t max_value = is_signed ? INT8_MAX : UINT8_MAX;
+
+  std::vector<char> data(count * columns.size());
+  for (size_t i = 0; i < columns.size(); ++i) {
+    if (columns[i]->size() != count) {
+      return false;
+    }
+
+    for (size_t j = 0; j < count; ++j) {
+      const float_t value = (*columns[i])[j];
+      if (value < min_value || value > max_value) {
+        logger.log_debug("Value " + std::to_string(value) +
+                         " does not fit into the cache of " + source_path);
+        return false;
+      }
+
+      data[i * count + j] = is_signed ? (char)(int8_t)value
+                                      : (char)(uint8_t)value;
+    }
+  }
+
+  return write_encoded(source_path, start_epoch, sample_freq,
+                       (uint32_t)columns.size(), data, is_signed);
+}
+
+bool SubjectCache::write_encoded(const std::string& source_path,
+                                 const int64_t start_epoch,
+                                 const uint32_t sample_freq,
+                                 const uint32_t columns,
+                                 const std::vector<char>& data,
+                                 const bool is_signed) noexcept {
+  Logging::Logger& logger = Logging::Logger::get_instance();
+
+  if (columns == 0 || data.size() % columns != 0) {
+    return false;
+  }
+
+  const size_t count = data.size() / columns;
+
+  const MappedFile source(source_path);
+  if (!source.is_mapped()) {
+    return false;
+  }
+
+  SubjectCacheHeader header{};
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = CACHE_VERSION;
+  header.columns = columns;
+  header.is_signed = is_signed;
+  header.sample_freq = sample_freq;
+  header.start_epoch = start_epoch;
+  header.count = count;
+  header.source_size = source.size();
+  header.source_mtime = file_mtime(source_path);
+  header.source_checksum = checksum(source.begin(), source.end());
+
+  const std::string path = cache_path(source_path);
+  // Processes sharing the data never write into the same file, the last
+  // rename wins
+  const std::string tmp_path =
+      path + "." + std::to_string(getpid()) + ".tmp";
+
+  std::ofstream output(tmp_path, std::ios::out | std::ios::binary);
+  if (!output.is_open()) {
+    logger.log_error(errors::ERRORS::COULD_NOT_OPEN_FILE_HANDLE,
+                     "(" + tmp_path + ")");
+    return false;
+  }
+
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  output.write(data.data(), data.size());
+  output.close();
+
+  std::error_code err{};
+  if (output.fail()) {
+    std::filesystem::remove(tmp_path, err);
+    return false;
+  }
+
+  std::filesystem::rename(tmp_path, path, err);
+  if (err) {
+    std::filesystem::remove(tmp_path, err);
+    return false;
+  }
+
+  logger.log_info("Cache " + path + " has been written");
+
+  return true;
+}
+
+}  // namespace DataPreprocessing
@@ -6,10 +6,11 @@
 namespace svg {
 Logging::Logger& logger = Logging::Logger::get_instance();
 
-void plot_correlation_values(const std::string& filename,
-                             const std::vector<float_t>& generated_values,
-                             const std::vector<float_t>& initial_values,
-                             const std::string& correlation_formula) noexcept {
+void plot_correlation_values(
+    const std::string& filename,
+    const DataPreprocessing::SeriesView generated_values,
+    const DataPreprocessing::SeriesView initial_values,
+    const std::string& correlation_formula) noexcept {
   std::ofstream plot_file;
 
   plot_file.open(filename);